@@ -0,0 +1,127 @@
+#ifndef ROTATION_H
+#define ROTATION_H
+
+#include <cstdint>
+#include <cmath>
+
+/** Fixed point incremental rotation
+  * A unit vector (cos, sin) is turned by a constant angle at each tick with a
+  * complex multiply, instead of computing trigonometric functions: 4 multiplies
+  * per tick. Rounding makes its length drift, it is brought back to 1 every
+  * renormalize ticks with a Newton step, 3 more multiplies.
+  *
+  * Values have Bits fractional bits and must keep a sign bit and an integer bit
+  * so that 1 and sums of two values fit: Q30 in int32_t (Rotation <int32_t, 30>)
+  * or Q14 in int16_t (Rotation <int16_t, 14>). Precision of the rotation step
+  * limits accuracy of the angle: Q30 stays within 1e-5 radian over 10000 ticks,
+  * Q14 has to be seeded again at least once per revolution.
+  */
+template <typename T = int32_t, unsigned Bits = 30>
+class Rotation {
+	static_assert(Bits + 2 <= 8 * sizeof(T), "values need a sign bit and an integer bit");
+
+	public:
+		static constexpr unsigned renormalize = 64; // Ticks between two renormalizations
+		static constexpr int64_t one = int64_t(1) << Bits; // Fixed point value of 1
+
+		/** Start at an angle, turning by a constant step
+		  * @param [in] start Initial angle in degrees
+		  * @param [in] step  Angle added at each tick in degrees
+		  */
+		void seed(double start, double step) {
+			c = fixed(std::cos(start * M_PI / 180));
+			s = fixed(std::sin(start * M_PI / 180));
+			step_c = fixed(std::cos(step * M_PI / 180));
+			step_s = fixed(std::sin(step * M_PI / 180));
+			ticks = 0;
+		}
+
+		/** Turn by one step **/
+		void tick() {
+			int64_t nc = (int64_t) c * step_c - (int64_t) s * step_s;
+			int64_t ns = (int64_t) s * step_c + (int64_t) c * step_s;
+			c = T(nc >> Bits);
+			s = T(ns >> Bits);
+			if (++ticks == renormalize) {
+				ticks = 0;
+				// One Newton step towards length 1: multiply by (3 - length^2) / 2
+				int64_t length2 = ((int64_t) c * c + (int64_t) s * s) >> Bits;
+				int64_t factor = (3 * one - length2) >> 1;
+				c = T(((int64_t) c * factor) >> Bits);
+				s = T(((int64_t) s * factor) >> Bits);
+			}
+		}
+
+		/** Give cosine of current angle
+		  * @return Cosine with Bits fractional bits
+		  */
+		T cos() const { return c; }
+
+		/** Give sine of current angle
+		  * @return Sine with Bits fractional bits
+		  */
+		T sin() const { return s; }
+
+	private:
+		/** Convert to fixed point, rounding to nearest **/
+		static T fixed(double v) { return T(std::floor(v * one + 0.5)); }
+
+		T c = T(one); // Cosine of current angle
+		T s = 0; // Sine of current angle
+		T step_c = T(one); // Cosine of step
+		T step_s = 0; // Sine of step
+		unsigned ticks = 0; // Ticks since last renormalization
+};
+
+/** Position of a led on its epicycloid, advanced by one angle step per tick
+  * The led turns with its wheel around the inner circle, at a + b from center,
+  * and around the wheel center, (a + b) / b times faster. Positions are
+  * normalized: they stay in -1..1 when radius is at least a + b + r.
+  *   x = ((a + b) sin(angle) + r sin((a + b) / b angle + alpha)) / radius
+  *   y = ((a + b) cos(angle) + r cos((a + b) / b angle + alpha)) / radius
+  */
+template <typename T = int32_t, unsigned Bits = 30>
+class EpicycloidTracker {
+	public:
+		static constexpr int64_t one = Rotation <T, Bits>::one; // Fixed point value of 1
+
+		/** Place led at first angle step
+		  * @param [in] a      Radius of inner circle
+		  * @param [in] b      Radius of outer circle
+		  * @param [in] r      Radius of led bar position
+		  * @param [in] alpha  Angle of led bar position in degrees
+		  * @param [in] radius Bound of led distance to center
+		  * @param [in] start  Angle of wheel at first step in degrees
+		  * @param [in] step   Angle of wheel added at each step in degrees
+		  */
+		void seed(double a, double b, double r, double alpha, double radius, double start, double step) {
+			center = T(std::floor((a + b) / radius * one + 0.5));
+			arm = T(std::floor(r / radius * one + 0.5));
+			wheel.seed(start, step);
+			led.seed((a + b) / b * start + alpha, (a + b) / b * step);
+		}
+
+		/** Advance to next angle step **/
+		void tick() {
+			wheel.tick();
+			led.tick();
+		}
+
+		/** Give normalized X position
+		  * @return X with Bits fractional bits
+		  */
+		T x() const { return T(((int64_t) center * wheel.sin() + (int64_t) arm * led.sin()) >> Bits); }
+
+		/** Give normalized Y position
+		  * @return Y with Bits fractional bits
+		  */
+		T y() const { return T(((int64_t) center * wheel.cos() + (int64_t) arm * led.cos()) >> Bits); }
+
+	private:
+		Rotation <T, Bits> wheel; // Angle of wheel center around inner circle
+		Rotation <T, Bits> led; // Angle of led around wheel center
+		T center = 0; // Distance of wheel center to center, normalized
+		T arm = 0; // Distance of led to wheel center, normalized
+};
+
+#endif // ROTATION_H
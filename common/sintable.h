@@ -0,0 +1,106 @@
+#ifndef SINTABLE_H
+#define SINTABLE_H
+
+#include <cstdint>
+#include <limits>
+
+/** Fixed point sine and cosine tables, computed by the compiler
+  * SinTable <Steps, T, Bits> holds sin(2 pi i / Steps) for each step i, as T
+  * with Bits fractional bits, saturated to the range of T. Tables are constant
+  * data: they live in flash on the target and cost nothing at startup.
+  */
+namespace sintable {
+
+constexpr double pi = 3.14159265358979323846;
+
+/** Sum of Taylor series of sine from term x^n / n!, good to double precision on -pi/2..pi/2 **/
+constexpr double series(double x2, double term, unsigned n) {
+	return (n > 27) ? 0 : term + series(x2, -term * x2 / ((n + 1) * (n + 2)), n + 2);
+}
+
+/** Sine of an angle in -pi/2..pi/2 **/
+constexpr double sin_reduced(double x) {
+	return series(x * x, x, 1);
+}
+
+/** Sine of a fraction of turn, reduced to -pi/2..pi/2 with exact integer arithmetic
+  * @param [in] i     Step, from 0 to steps
+  * @param [in] steps Number of steps in a turn, multiple of 4
+  * @return sin(2 pi i / steps)
+  */
+constexpr double sin_step(long i, long steps) {
+	return (4 * i <= steps) ? sin_reduced(2 * pi * i / steps) :
+	       (4 * i <= 3 * steps) ? sin_reduced(2 * pi * (steps / 2 - i) / steps) :
+	       sin_reduced(2 * pi * (i - steps) / steps);
+}
+
+/** Convert to fixed point, rounding to nearest and saturating
+  * @param [in] v    Value
+  * @param [in] one  Fixed point value of 1
+  * @return Fixed point value
+  */
+template <typename T>
+constexpr T to_fixed(double v, double one) {
+	return (v * one >= (double) std::numeric_limits <T>::max()) ? std::numeric_limits <T>::max() :
+	       (v * one <= (double) std::numeric_limits <T>::min()) ? std::numeric_limits <T>::min() :
+	       (v >= 0) ? T(v * one + 0.5) : T(v * one - 0.5);
+}
+
+/** Pack of indices, built in logarithmic template depth **/
+template <unsigned... I> struct Indices {};
+
+template <typename A, typename B> struct Concat;
+template <unsigned... A, unsigned... B>
+struct Concat <Indices <A...>, Indices <B...>> {
+	typedef Indices <A..., (sizeof...(A) + B)...> type;
+};
+
+template <unsigned N> struct MakeIndices {
+	typedef typename Concat <typename MakeIndices <N / 2>::type, typename MakeIndices <N - N / 2>::type>::type type;
+};
+template <> struct MakeIndices <0> { typedef Indices <> type; };
+template <> struct MakeIndices <1> { typedef Indices <0> type; };
+
+/** Values of a table, one per index **/
+template <unsigned Steps, typename T, unsigned Bits, typename I> struct Values;
+template <unsigned Steps, typename T, unsigned Bits, unsigned... I>
+struct Values <Steps, T, Bits, Indices <I...>> {
+	static constexpr T values[sizeof...(I)] = {
+		to_fixed <T> (sin_step(I % Steps, Steps), (double) (1ull << Bits))...
+	};
+};
+template <unsigned Steps, typename T, unsigned Bits, unsigned... I>
+constexpr T Values <Steps, T, Bits, Indices <I...>>::values[sizeof...(I)];
+
+} // namespace sintable
+
+/** Sine and cosine of each step of a turn
+  * @tparam Steps Number of steps in a turn, multiple of 4
+  * @tparam T     Integer type of values
+  * @tparam Bits  Number of fractional bits of values
+  */
+template <unsigned Steps, typename T = int16_t, unsigned Bits = 15>
+struct SinTable {
+	static_assert(Steps % 4 == 0, "cosine is read a quarter of turn after sine");
+	static_assert(Bits < 8 * sizeof(T), "values need a sign bit");
+
+	static constexpr unsigned steps = Steps; // Number of steps in a turn
+	static constexpr unsigned bits = Bits; // Number of fractional bits of values
+
+	// Sine of a turn and a quarter, so that cosine is a shifted sine
+	typedef sintable::Values <Steps, T, Bits, typename sintable::MakeIndices <Steps + Steps / 4>::type> Table;
+
+	/** Give sine of a step
+	  * @param [in] step Step, any value
+	  * @return sin(2 pi step / Steps) with Bits fractional bits
+	  */
+	static constexpr T sin(unsigned step) { return Table::values[step % Steps]; }
+
+	/** Give cosine of a step
+	  * @param [in] step Step, any value
+	  * @return cos(2 pi step / Steps) with Bits fractional bits
+	  */
+	static constexpr T cos(unsigned step) { return Table::values[step % Steps + Steps / 4]; }
+};
+
+#endif // SINTABLE_H
@@ -0,0 +1,230 @@
+#ifndef SLICES_H
+#define SLICES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/** Slice table layout
+  * Colors of every led bar pixel at every angle step, computed offline by
+  * azipov_slicer so that the rotor only has to stream them out.
+  * A slice table starts with a struct slices_header, all fields little endian,
+  * followed by:
+  *   one struct slices_led per led bar
+  *   colors RGB palette entries, padded to 4 bytes, entry 0 is black
+  *   if keyframe is not 0, one uint32 per keyframe, offset of its step from
+  *   start of step data
+  *   step data
+  *
+  * Each step holds, for each led bar, its pixels from bottom to top, in format:
+  *   SLICES_RGB    3 bytes per pixel, RGB
+  *   SLICES_PAL8   1 byte per pixel, palette index
+  *   SLICES_PAL4   4 bits per pixel, palette index, first pixel in low bits
+  * Each bar is padded to whole bytes.
+  *
+  * If keyframe is 0, steps are stored one after the other. Otherwise each step
+  * is coded as changes of its bytes from previous step, as a sequence of:
+  *   0x00..0x7f     n + 1 bytes unchanged
+  *   0x80..0xff     n - 0x7f bytes, whose new values follow
+  * and every keyframe steps, starting from 0, a step is coded from all bytes
+  * at 0 (black) instead, so that decoding can start there.
+  *
+  * Angle step s shows wheel n at s * step_udeg / 1e6 + 360 * n / nr degrees
+  * (integer division), and steps cover turns turns of the inner angle.
+  */
+#define SLICES_MAGIC "AZPS"
+#define SLICES_VERSION 2
+#define SLICES_RGB 0
+#define SLICES_PAL8 1
+#define SLICES_PAL4 2
+
+/** Header of a slice table **/
+struct slices_header {
+	char magic[4]; // SLICES_MAGIC
+	uint16_t version; // SLICES_VERSION
+	uint16_t leds; // Number of led bars
+	uint16_t pixels; // Number of pixels of each led bar
+	uint16_t nr; // Number of wheels
+	uint32_t steps; // Number of angle steps
+	uint32_t step_udeg; // Angle between two steps, in millionths of degree
+	uint32_t turns; // Number of turns covered by all steps
+	uint16_t format; // Pixel format, SLICES_RGB, SLICES_PAL8 or SLICES_PAL4
+	uint16_t colors; // Number of palette entries, 0 for SLICES_RGB
+	uint16_t keyframe; // Steps between two keyframes, 0 if steps are not delta coded
+	uint16_t reserved; // 0
+};
+
+/** Led bar of a slice table **/
+struct slices_led {
+	uint16_t wheel_nr; // Number of wheel on which the led bar is present
+	uint16_t reserved; // 0
+};
+
+/** Give number of bytes of a led bar in a step
+  * @param [in] header Slice table
+  * @return Size of a bar
+  */
+static inline size_t slices_bar_bytes(const struct slices_header * header) {
+	if (header->format == SLICES_PAL4)
+		return (header->pixels + 1) / 2;
+	return (size_t) header->pixels * (header->format == SLICES_PAL8 ? 1 : 3);
+}
+
+/** Give number of bytes of a decoded step
+  * @param [in] header Slice table
+  * @return Size of a step
+  */
+static inline size_t slices_step_bytes(const struct slices_header * header) {
+	return header->leds * slices_bar_bytes(header);
+}
+
+/** Give led bars of a slice table
+  * @param [in] header Slice table
+  * @return Description of each led bar
+  */
+static inline const struct slices_led * slices_leds(const struct slices_header * header) {
+	return (const struct slices_led *) (header + 1);
+}
+
+/** Give palette of a slice table
+  * @param [in] header Slice table
+  * @return RGB of each palette entry
+  */
+static inline const uint8_t * slices_palette(const struct slices_header * header) {
+	return (const uint8_t *) (slices_leds(header) + header->leds);
+}
+
+/** Give keyframe index of a slice table, if it is delta coded
+  * @param [in] header Slice table
+  * @return Offset of each keyframe in step data
+  */
+static inline const uint32_t * slices_keyframes(const struct slices_header * header) {
+	return (const uint32_t *) (slices_palette(header) + (header->colors * 3 + 3) / 4 * 4);
+}
+
+/** Give start of step data of a slice table
+  * @param [in] header Slice table
+  * @return First step
+  */
+static inline const uint8_t * slices_data(const struct slices_header * header) {
+	const uint32_t * keyframes = slices_keyframes(header);
+	if (header->keyframe)
+		keyframes += (header->steps + header->keyframe - 1) / header->keyframe;
+	return (const uint8_t *) keyframes;
+}
+
+/** Give pixels of a led bar at an angle step, if steps are not delta coded
+  * @param [in] header Slice table
+  * @param [in] step   Angle step, below header->steps
+  * @param [in] led    Led bar, below header->leds
+  * @return Pixels of the bar from bottom to top
+  */
+static inline const uint8_t * slices_column(const struct slices_header * header, uint32_t step, uint16_t led) {
+	return slices_data(header) + ((size_t) step * header->leds + led) * slices_bar_bytes(header);
+}
+
+/** Apply changes of a delta coded step
+  * @param [in]     code   Coded step
+  * @param [in,out] frame  Previous step, replaced by decoded one
+  * @param [in]     length Number of bytes of a step
+  * @return Next coded step
+  */
+static inline const uint8_t * slices_delta(const uint8_t * code, uint8_t * frame, size_t length) {
+	size_t i = 0;
+	while (i < length) {
+		uint8_t c = *code++;
+		if (c < 0x80) {
+			i += c + 1;
+		} else {
+			size_t n = c - 0x7f;
+			if (n > length - i)
+				n = length - i;
+			memcpy(frame + i, code, n);
+			code += c - 0x7f;
+			i += n;
+		}
+	}
+	return code;
+}
+
+/** Decoding state of a slice table **/
+struct slices_player {
+	const struct slices_header * header; // Slice table
+	uint8_t * frame; // Buffer of slices_step_bytes(), holding decoded step of delta coded tables
+	const uint8_t * pixels; // Pixels of current step
+	const uint8_t * code; // Coded next step
+	uint32_t step; // Current step
+};
+
+/** Decode a given step, from the keyframe before it
+  * @param [in,out] player Decoding state, with header and frame set
+  * @param [in]     step   Angle step, below header->steps
+  */
+static inline void slices_seek(struct slices_player * player, uint32_t step) {
+	const struct slices_header * header = player->header;
+	size_t length = slices_step_bytes(header);
+	if (!header->keyframe) {
+		player->step = step;
+		player->pixels = slices_data(header) + step * length;
+		return;
+	}
+
+	uint32_t s = step - step % header->keyframe;
+	const uint8_t * code = slices_data(header) + slices_keyframes(header)[s / header->keyframe];
+	memset(player->frame, 0, length);
+	for (;;) {
+		code = slices_delta(code, player->frame, length);
+		if (s == step)
+			break;
+		++s;
+	}
+	player->step = step;
+	player->pixels = player->frame;
+	player->code = code;
+}
+
+/** Decode next step, going back to step 0 after last one
+  * @param [in,out] player Decoding state, after slices_seek()
+  */
+static inline void slices_next(struct slices_player * player) {
+	const struct slices_header * header = player->header;
+	uint32_t step = player->step + 1;
+	if (step >= header->steps) {
+		slices_seek(player, 0);
+		return;
+	}
+	if (!header->keyframe) {
+		player->step = step;
+		player->pixels += slices_step_bytes(header);
+		return;
+	}
+
+	// Keyframes restart from black
+	if (step % header->keyframe == 0)
+		memset(player->frame, 0, slices_step_bytes(header));
+	player->code = slices_delta(player->code, player->frame, slices_step_bytes(header));
+	player->step = step;
+}
+
+/** Give color of a pixel of current step
+  * @param [in]  player Decoding state
+  * @param [in]  led    Led bar, below header->leds
+  * @param [in]  pixel  Pixel of bar from bottom, below header->pixels
+  * @param [out] rgb    Color of pixel
+  */
+static inline void slices_rgb(const struct slices_player * player, uint16_t led, uint16_t pixel, uint8_t rgb[3]) {
+	const struct slices_header * header = player->header;
+	const uint8_t * bar = player->pixels + led * slices_bar_bytes(header);
+	const uint8_t * c;
+	if (header->format == SLICES_RGB)
+		c = bar + pixel * 3;
+	else if (header->format == SLICES_PAL8)
+		c = slices_palette(header) + bar[pixel] * 3;
+	else
+		c = slices_palette(header) + ((bar[pixel / 2] >> (4 * (pixel % 2))) & 0x0f) * 3;
+	rgb[0] = c[0];
+	rgb[1] = c[1];
+	rgb[2] = c[2];
+}
+
+#endif // SLICES_H
@@ -0,0 +1,123 @@
+#ifndef STORE_H
+#define STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/** Content store layout
+  * A directory of named contents, written by azipov_store and read in place
+  * by the firmware from a flash region of its own.
+  * A content store starts with a struct store_header, all fields little
+  * endian, followed by:
+  *   one struct store_entry per content
+  *   data of each content, starting on 4 bytes boundaries so that tables can
+  *   be read where they are
+  *
+  * Contents are typed from their own magic:
+  *   STORE_SLICES    slice table (slices.h)
+  *   STORE_VOLUME    AZPV or AZPR volume
+  *   STORE_SEQUENCE  AZPA sequence of volumes
+  *   STORE_RAW       anything else
+  * crc is the CRC-32 (IEEE 802.3) of all bytes following the header, up to size.
+  */
+#define STORE_MAGIC "AZPD"
+#define STORE_VERSION 1
+#define STORE_NAME_BYTES 24
+#define STORE_RAW 0
+#define STORE_SLICES 1
+#define STORE_VOLUME 2
+#define STORE_SEQUENCE 3
+
+/** Header of a content store **/
+struct store_header {
+	char magic[4]; // STORE_MAGIC
+	uint16_t version; // STORE_VERSION
+	uint16_t entries; // Number of contents
+	uint32_t size; // Number of bytes of the store, header included
+	uint32_t crc; // CRC-32 of bytes after header
+};
+
+/** Content of a store **/
+struct store_entry {
+	char name[STORE_NAME_BYTES]; // Name, 0 terminated
+	uint16_t type; // STORE_SLICES, STORE_VOLUME, STORE_SEQUENCE or STORE_RAW
+	uint16_t reserved; // 0
+	uint32_t offset; // Offset of data from start of store, multiple of 4
+	uint32_t size; // Number of bytes of data
+};
+
+/** Update a CRC-32 (IEEE 802.3, reflected) with more bytes
+  * @param [in] crc    CRC of previous bytes, 0 for none
+  * @param [in] data   Bytes
+  * @param [in] length Number of bytes
+  * @return CRC of previous bytes and data
+  */
+static inline uint32_t store_crc32(uint32_t crc, const void * data, size_t length) {
+	const uint8_t * p = (const uint8_t *) data;
+	crc = ~crc;
+	while (length--) {
+		crc ^= *p++;
+		for (int k = 0; k < 8; ++k)
+			crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
+/** Give directory of a content store
+  * @param [in] header Content store
+  * @return Entry of each content
+  */
+static inline const struct store_entry * store_entries(const struct store_header * header) {
+	return (const struct store_entry *) (header + 1);
+}
+
+/** Give data of a content
+  * @param [in] header Content store
+  * @param [in] entry  Content of this store
+  * @return First byte of content
+  */
+static inline const void * store_data(const struct store_header * header, const struct store_entry * entry) {
+	return (const uint8_t *) header + entry->offset;
+}
+
+/** Check that a content store is whole and fits where it is
+  * @param [in] header   Content store
+  * @param [in] capacity Number of bytes readable from header
+  * @param [in] crc      Non 0 to check CRC of all data too, reading it all
+  * @return 1 if store is valid, 0 otherwise
+  */
+static inline int store_check(const struct store_header * header, size_t capacity, int crc) {
+	if (capacity < sizeof(struct store_header) || memcmp(header->magic, STORE_MAGIC, 4) ||
+	    header->version != STORE_VERSION || header->size > capacity)
+		return 0;
+	size_t directory = sizeof(struct store_header) + (size_t) header->entries * sizeof(struct store_entry);
+	if (directory > header->size)
+		return 0;
+	const struct store_entry * entries = store_entries(header);
+	for (uint16_t i = 0; i < header->entries; ++i) {
+		if (entries[i].offset % 4 || entries[i].offset < directory || entries[i].offset > header->size ||
+		    entries[i].size > header->size - entries[i].offset ||
+		    !memchr(entries[i].name, 0, STORE_NAME_BYTES))
+			return 0;
+	}
+	if (crc && store_crc32(0, header + 1, header->size - sizeof(struct store_header)) != header->crc)
+		return 0;
+	return 1;
+}
+
+/** Find a content by name
+  * @param [in] header Content store, checked
+  * @param [in] name   Name of content
+  * @return Index of content, -1 if there is none
+  */
+static inline int store_find(const struct store_header * header, const char * name) {
+	const struct store_entry * entries = store_entries(header);
+	for (uint16_t i = 0; i < header->entries; ++i) {
+		if (!strncmp(entries[i].name, name, STORE_NAME_BYTES))
+			return i;
+	}
+	return -1;
+}
+
+#endif // STORE_H
@@ -0,0 +1,264 @@
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "store.h"
+
+/** Upload protocol
+  * A content store image is sent to the board over a serial link, in frames:
+  *   0xa5 0x5a type seq length(2) payload(length) crc(4)
+  * all fields little endian, crc being the CRC-32 of type, seq, length and
+  * payload. Frames with a bad CRC are dropped, the receiver resynchronizes on
+  * the next 0xa5 0x5a.
+  *
+  * The host sends:
+  *   UPLOAD_BEGIN   size(4) crc(4) of the image, receiver erases room for it
+  *   UPLOAD_DATA    offset(4) then up to UPLOAD_MAX_DATA bytes of the image,
+  *                  a multiple of 4 bytes but in the last frame
+  *   UPLOAD_END     receiver checks the whole image and switches to it
+  * with seq counting frames from 0 for UPLOAD_BEGIN, wrapping at 256.
+  *
+  * The receiver answers each frame with UPLOAD_ACK:
+  *   status(1) seq(1) 0(2) offset(4)
+  * seq being the next frame it expects and offset the image bytes written.
+  * It only takes frames in order: on a gap it answers UPLOAD_RESEND once, and
+  * the host goes back to seq. Frames of an upload come again when their
+  * acknowledgement was lost, even after UPLOAD_END: they are answered with
+  * the status given to UPLOAD_END. The host keeps at most UPLOAD_WINDOW frames not
+  * acknowledged, so that a receiver buffer of UPLOAD_WINDOW frames never
+  * overflows while it writes flash.
+  */
+#define UPLOAD_SYNC0 0xa5
+#define UPLOAD_SYNC1 0x5a
+#define UPLOAD_HEADER_BYTES 6
+#define UPLOAD_CRC_BYTES 4
+#define UPLOAD_MAX_DATA 512
+#define UPLOAD_MAX_PAYLOAD (4 + UPLOAD_MAX_DATA)
+#define UPLOAD_MAX_FRAME (UPLOAD_HEADER_BYTES + UPLOAD_MAX_PAYLOAD + UPLOAD_CRC_BYTES)
+#define UPLOAD_WINDOW 6
+#define UPLOAD_BAUD 2000000
+
+/** Frame types **/
+#define UPLOAD_BEGIN 0x01
+#define UPLOAD_DATA 0x02
+#define UPLOAD_END 0x03
+#define UPLOAD_ACK 0x81
+
+/** Statuses of UPLOAD_ACK **/
+#define UPLOAD_OK 0 // Frame taken
+#define UPLOAD_RESEND 1 // Frames lost, send again from seq
+#define UPLOAD_REFUSED 2 // Frame not expected, or malformed
+#define UPLOAD_TOO_LARGE 3 // Image does not fit
+#define UPLOAD_FLASH_ERROR 4 // Flash could not be erased or written
+#define UPLOAD_BAD_IMAGE 5 // Image is not a valid content store, or CRC differs
+
+/** Encode a frame
+  * @param [in]  type    Frame type
+  * @param [in]  seq     Frame number
+  * @param [in]  payload Payload
+  * @param [in]  length  Number of bytes of payload, at most UPLOAD_MAX_PAYLOAD
+  * @param [out] frame   Encoded frame, of up to UPLOAD_MAX_FRAME bytes
+  * @return Number of bytes of frame
+  */
+static inline size_t upload_encode(uint8_t type, uint8_t seq, const void * payload, uint16_t length, uint8_t * frame) {
+	frame[0] = UPLOAD_SYNC0;
+	frame[1] = UPLOAD_SYNC1;
+	frame[2] = type;
+	frame[3] = seq;
+	frame[4] = length & 0xff;
+	frame[5] = length >> 8;
+	memcpy(frame + UPLOAD_HEADER_BYTES, payload, length);
+	uint32_t crc = store_crc32(0, frame + 2, UPLOAD_HEADER_BYTES - 2 + length);
+	for (int i = 0; i < 4; ++i)
+		frame[UPLOAD_HEADER_BYTES + length + i] = (crc >> (8 * i)) & 0xff;
+	return UPLOAD_HEADER_BYTES + length + UPLOAD_CRC_BYTES;
+}
+
+/** Read a little endian value of 4 bytes **/
+static inline uint32_t upload_u32(const uint8_t * p) {
+	return p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+/** Write a little endian value of 4 bytes **/
+static inline void upload_put_u32(uint8_t * p, uint32_t v) {
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = v >> 24;
+}
+
+/** Frame decoding state **/
+struct upload_parser {
+	uint8_t frame[UPLOAD_MAX_FRAME]; // Bytes of frame so far
+	size_t length; // Number of bytes in frame
+	uint32_t errors; // Number of frames dropped
+};
+
+/** Add a received byte to a frame
+  * @param [in,out] parser Decoding state, zeroed at start
+  * @param [in]     byte   Received byte
+  * @return 1 if a valid frame is complete, to be read before next byte
+  */
+static inline int upload_parse(struct upload_parser * parser, uint8_t byte) {
+	size_t n = parser->length;
+	if (n >= UPLOAD_HEADER_BYTES && n == (size_t) UPLOAD_HEADER_BYTES + (parser->frame[4] | parser->frame[5] << 8) + UPLOAD_CRC_BYTES)
+		n = 0; // Previous frame was complete
+	if ((n == 0 && byte != UPLOAD_SYNC0) || (n == 1 && byte != UPLOAD_SYNC1)) {
+		parser->length = (byte == UPLOAD_SYNC0) ? 1 : 0;
+		parser->frame[0] = byte;
+		return 0;
+	}
+	parser->frame[n++] = byte;
+	parser->length = n;
+	if (n < UPLOAD_HEADER_BYTES)
+		return 0;
+
+	size_t payload = parser->frame[4] | parser->frame[5] << 8;
+	if (payload > UPLOAD_MAX_PAYLOAD) {
+		++parser->errors;
+		parser->length = 0;
+		return 0;
+	}
+	if (n < UPLOAD_HEADER_BYTES + payload + UPLOAD_CRC_BYTES)
+		return 0;
+	if (store_crc32(0, parser->frame + 2, UPLOAD_HEADER_BYTES - 2 + payload) != upload_u32(parser->frame + UPLOAD_HEADER_BYTES + payload)) {
+		++parser->errors;
+		parser->length = 0;
+		return 0;
+	}
+	return 1;
+}
+
+/** Receiving side of uploads, writing the image through callbacks
+  * Callbacks return 0 on success or an UPLOAD_ACK status.
+  */
+struct upload_receiver {
+	struct upload_parser parser; // Frame decoding
+	uint8_t expected; // Number of next frame to take
+	uint8_t resend; // Non 0 once UPLOAD_RESEND was sent for current gap
+	uint8_t receiving; // Non 0 between UPLOAD_BEGIN and UPLOAD_END
+	uint8_t finished; // Non 0 once UPLOAD_END of last upload was taken
+	uint8_t status; // Status given to UPLOAD_END of last upload
+	uint32_t size; // Image size
+	uint32_t crc; // Image CRC
+	uint32_t offset; // Image bytes written
+	void * context; // Given to callbacks
+	int (*erase)(void * context, uint32_t size); // Make room for image
+	int (*program)(void * context, uint32_t offset, const uint8_t * data, uint32_t length); // Write image bytes
+	int (*finish)(void * context, uint32_t size, uint32_t crc); // Check image and use it
+	void (*send)(void * context, const uint8_t * frame, size_t length); // Send bytes to host
+};
+
+/** Answer a frame
+  * @param [in] receiver Receiving side
+  * @param [in] status   UPLOAD_OK or an error
+  */
+static inline void upload_ack(struct upload_receiver * receiver, uint8_t status) {
+	uint8_t payload[8] = {status, receiver->expected, 0, 0};
+	uint8_t frame[UPLOAD_HEADER_BYTES + sizeof(payload) + UPLOAD_CRC_BYTES];
+	upload_put_u32(payload + 4, receiver->offset);
+	receiver->send(receiver->context, frame, upload_encode(UPLOAD_ACK, 0, payload, sizeof(payload), frame));
+}
+
+/** Take a valid frame
+  * @param [in,out] receiver Receiving side
+  */
+static inline void upload_frame(struct upload_receiver * receiver) {
+	const uint8_t * frame = receiver->parser.frame;
+	uint8_t type = frame[2], seq = frame[3];
+	uint16_t length = frame[4] | frame[5] << 8;
+	const uint8_t * payload = frame + UPLOAD_HEADER_BYTES;
+
+	if (type == UPLOAD_BEGIN) {
+		if (length != 8) {
+			upload_ack(receiver, UPLOAD_REFUSED);
+			return;
+		}
+		uint32_t size = upload_u32(payload), crc = upload_u32(payload + 4);
+		// Acknowledgement was lost: do not erase again
+		if (receiver->receiving && !receiver->offset && (uint8_t) (seq + 1) == receiver->expected &&
+		    size == receiver->size && crc == receiver->crc) {
+			upload_ack(receiver, UPLOAD_OK);
+			return;
+		}
+		receiver->receiving = 0;
+		receiver->finished = 0;
+		receiver->size = size;
+		receiver->crc = crc;
+		receiver->offset = 0;
+		receiver->expected = seq + 1;
+		receiver->resend = 0;
+		int status = receiver->erase(receiver->context, size);
+		if (!status)
+			receiver->receiving = 1;
+		upload_ack(receiver, status);
+		return;
+	}
+
+	if (type != UPLOAD_DATA && type != UPLOAD_END) {
+		upload_ack(receiver, UPLOAD_REFUSED);
+		return;
+	}
+	if (!receiver->receiving) {
+		// Acknowledgement of UPLOAD_END was lost: frames up to it come again
+		if (receiver->finished && (uint8_t) (receiver->expected - seq - 1) < 128)
+			upload_ack(receiver, receiver->status);
+		else
+			upload_ack(receiver, UPLOAD_REFUSED);
+		return;
+	}
+	if (seq != receiver->expected) {
+		// Frames already taken come again when an acknowledgement was lost,
+		// answer so that the host moves on. A gap is reported once.
+		if ((uint8_t) (receiver->expected - seq) <= 128)
+			upload_ack(receiver, UPLOAD_OK);
+		else if (!receiver->resend) {
+			receiver->resend = 1;
+			upload_ack(receiver, UPLOAD_RESEND);
+		}
+		return;
+	}
+	receiver->resend = 0;
+
+	int status;
+	if (type == UPLOAD_DATA) {
+		uint32_t offset = length >= 4 ? upload_u32(payload) : 0;
+		uint32_t n = length >= 4 ? length - 4 : 0;
+		if (length < 4 || offset != receiver->offset || n > receiver->size - offset) {
+			status = UPLOAD_REFUSED;
+		} else {
+			status = receiver->program(receiver->context, offset, payload + 4, n);
+			if (!status)
+				receiver->offset += n;
+		}
+	} else {
+		if (receiver->offset != receiver->size)
+			status = UPLOAD_BAD_IMAGE;
+		else
+			status = receiver->finish(receiver->context, receiver->size, receiver->crc);
+		receiver->receiving = 0;
+		receiver->finished = 1;
+		receiver->status = status;
+	}
+	// Frame is taken even when refused, host has to start over
+	receiver->expected = seq + 1;
+	if (status)
+		receiver->receiving = 0;
+	upload_ack(receiver, status);
+}
+
+/** Take received bytes
+  * @param [in,out] receiver Receiving side, zeroed then with callbacks set
+  * @param [in]     data     Received bytes
+  * @param [in]     length   Number of bytes
+  */
+static inline void upload_receive(struct upload_receiver * receiver, const uint8_t * data, size_t length) {
+	for (size_t i = 0; i < length; ++i) {
+		if (upload_parse(&receiver->parser, data[i]))
+			upload_frame(receiver);
+	}
+}
+
+#endif // UPLOAD_H
@@ -1,14 +1,22 @@
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include <GL/glut.h>
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <ctime>
 #include <cstring>
+#include <string>
 #include <iostream>
-#include <fstream>
 #include <unistd.h>
 #include <getopt.h>
+#include <sys/stat.h>
+#include "softrender.h"
+#include "volume.h"
+#include "sequence.h"
+#include "sampler.h"
+#include "geometry.h"
 
 /** Timespec for FPS limiting **/
 struct timespec wakeup;
@@ -22,6 +30,25 @@ struct {
 	int height = 600;
 } screen;
 
+/** Headless rendering parameters **/
+struct {
+	bool enabled = false; // Render frames to files instead of a window
+	int frames = 1; // Number of frames to render
+	std::string out = "."; // Directory where frames are written
+} headless;
+
+/** Software renderer data **/
+struct {
+	bool enabled = false; // Render window content with the software renderer instead of OpenGL
+	Framebuffer fb; // Rendered frame
+} software;
+
+/** Worker threads generating trace and rendering with software renderer **/
+struct {
+	int threads = 0; // Number of threads, 0 to match hardware
+	ThreadPool * pool = nullptr;
+} workers;
+
 /** Camera data **/
 struct {
 	float distance = 20.0f;
@@ -29,12 +56,6 @@ struct {
 	float angle_z = 0.0f;
 } camera;
 
-struct Led {
-	int wheel_nr; // Number of wheel on which the led bar is present
-	float r; // Radius of led bar position
-	float alpha; // Angle of lef bar position
-};
-
 /** POV emulation parameters **/
 struct {
 	bool animated; // Is it animated ?
@@ -47,120 +68,473 @@ struct {
 	float b; // Radius of outer circle
 	float dh; // Height step
 	float h; // Height
+	int filter; // Picture sampling filter, SAMPLE_NEAREST or SAMPLE_TRILINEAR
 } emu;
 
-/** Color **/
-struct color {
-	uint8_t r; // Red
-	uint8_t g; // Green
-	uint8_t b; // Blue
-};
-
 /** Colors Buffer **/
-#define PICTURE_X 24
-#define PICTURE_Y 24
-#define PICTURE_Z 24
-color picture[PICTURE_X][PICTURE_Y][PICTURE_Z];
-
-/** Gives a color depending on led position
-  * @param [in] x X position in -1..1 range
-  * @param [in] y Y position in -1..1 range
-  * @param [in] z Z position in 0..1 range
-  * @return color to set
+Volume still; // Picture read from file, or default one
+const Volume * picture = &still; // Picture shown, either still one or current frame of sequence
+
+/** Animated picture **/
+struct {
+	Sequence sequence;
+	bool enabled = false; // Is a sequence played
+	float elapsed_ms = 0; // Time elapsed since current frame is shown
+} playback;
+
+/** Time between two frames in nanoseconds **/
+const float anim_intervalle = 40e6;
+
+/** Precomputed led trajectories, indexed by angle step **/
+struct {
+	// Parameters the tables were computed with
+	float da = 0;
+	float a = 0;
+	float b = 0;
+	int turns = 0;
+	int nr = 0;
+	size_t leds = 0;
+	int size_x = 0;
+	int size_y = 0;
+
+	float radius = 1; // Bound of led distance to center, positions are normalized by it
+	int steps = 0; // Number of angle steps in a full trace
+	std::vector <float> x; // Normalized X position of led l at step s is x[l * steps + s]
+	std::vector <float> y; // Normalized Y position of led l at step s is y[l * steps + s]
+	std::vector <uint32_t> column; // Picture column of led l at step s is column[l * steps + s]
+} trajectories;
+
+/** Precomputed sampling heights along led bars **/
+struct {
+	// Parameters the tables were computed with
+	float dh = 0;
+	float h = 0;
+	int size_z = 0;
+
+	std::vector <float> heights; // Height of each sample in scene
+	std::vector <float> z; // Normalized height of each sample
+	std::vector <int> layers; // Picture layer of each sample
+} bars;
+
+/** Recompute trajectory tables if emulation parameters changed since last call
+  * @return true if tables were recomputed
   */
-color color_chooser(float x, float y, float z) {
-	if (x < -1) x = -1;
-	if (x > 1) x = 1;
-	if (y < -1) y = -1;
-	if (y > 1) y = 1;
-	if (z < 0) z = 0;
-	if (z > 1) z = 1;
-
-	int ix, iy, iz;
-	ix = (x + 1) / 2 * (PICTURE_X - 1);
-	iy = (y + 1) / 2 * (PICTURE_Y - 1);
-	iz = z * (PICTURE_Z - 1);
-
-	return picture[ix][iy][iz];
+bool update_trajectories() {
+	if (trajectories.da == emu.da && trajectories.a == emu.a && trajectories.b == emu.b &&
+	    trajectories.turns == emu.turns && trajectories.nr == emu.nr && trajectories.leds == emu.leds.size() &&
+	    trajectories.size_x == picture->size_x && trajectories.size_y == picture->size_y)
+		return false;
+
+	trajectories.da = emu.da;
+	trajectories.a = emu.a;
+	trajectories.b = emu.b;
+	trajectories.turns = emu.turns;
+	trajectories.nr = emu.nr;
+	trajectories.leds = emu.leds.size();
+	trajectories.size_x = picture->size_x;
+	trajectories.size_y = picture->size_y;
+	trajectories.radius = trajectory_radius(emu.a, emu.b, emu.leds);
+	trajectories.steps = (emu.da > 0) ? ceil(emu.turns * 360 / emu.da) : 0;
+	trajectories.x.resize(trajectories.leds * trajectories.steps);
+	trajectories.y.resize(trajectories.leds * trajectories.steps);
+	trajectories.column.resize(trajectories.leds * trajectories.steps);
+
+	if (emu.nr > 0) {
+		workers.pool->parallel_for(trajectories.leds, 1, [] (size_t begin, size_t end) {
+			for (size_t l = begin; l < end; ++l) {
+				// Same positions as the slice table the rotor shows
+				Led & led = emu.leds[l];
+				size_t first = l * trajectories.steps;
+				led_trajectory(emu.a, emu.b, led, trajectories.radius, wheel_angle(0, emu.da, led.wheel_nr, emu.nr), emu.da,
+				               trajectories.steps, &trajectories.x[first], &trajectories.y[first]);
+				for (int s = 0; s < trajectories.steps; ++s) {
+					size_t i = first + s;
+					int ix, iy;
+					volume_column(*picture, trajectories.x[i], trajectories.y[i], ix, iy);
+					trajectories.column[i] = (uint32_t) ix * picture->size_y + iy;
+				}
+			}
+		});
+	}
+	return true;
 }
 
-/** Draw all leds of a wheel, and optionnaly the wheel itself
-  * @param [in] wheel_nr Wheel number
-  * @param [in] angle    Current angle of the wheel
-  * @param [in] circle   Should wheel be printed
+/** Recompute sampling heights if emulation parameters changed since last call
+  * @return true if heights were recomputed
   */
-void draw_leds(int wheel_nr, float angle, bool circle = false) {
-	glPushMatrix();
-
-	// Global position
-	glRotatef(angle, 0, 0, 1);
-	glTranslatef(emu.a + emu.b, 0, 0);
-	glRotatef(-angle, 0, 0, 1);
-	glRotatef(angle * (emu.a+emu.b)/(emu.b), 0, 0, 1);
-
-	// Draw circle
-	if (circle) {
-		int circle_pts = emu.b * 9;
-		glBegin(GL_LINE_LOOP);
-		glColor3d(0, 0, 0.3f);
-		for (int i = 0; i < circle_pts; ++i)
-			glVertex3d(
-				emu.b * cos(i * 2 * M_PI / circle_pts),
-				emu.b * sin(i * 2 * M_PI / circle_pts),
-				0
-			);
-		glEnd();
-		for (Led & led: emu.leds) {
-			if (wheel_nr != led.wheel_nr)
+bool update_bars() {
+	if (bars.dh == emu.dh && bars.h == emu.h && bars.size_z == picture->size_z)
+		return false;
+
+	bars.dh = emu.dh;
+	bars.h = emu.h;
+	bars.size_z = picture->size_z;
+	bar_heights(emu.dh, emu.h, bars.heights, bars.z);
+	bars.layers.clear();
+	for (float z: bars.z)
+		bars.layers.push_back(volume_layer(*picture, z));
+	return true;
+}
+
+/** Index columns of a picture used in place, the first time nearest sampling needs them
+  * Loading does not read mapped files, sequence frames are indexed as they are read
+  */
+void update_occupancy() {
+	if (emu.filter == SAMPLE_NEAREST && picture == &still && still.column_min.empty())
+		volume_index(still);
+}
+
+/** Lit led samples, laid out for vertex arrays **/
+struct Points {
+	std::vector <GLfloat> vertices; // X, Y, Z of each point
+	std::vector <GLubyte> colors; // R, G, B of each point
+	GLuint vbo[2] = {0, 0}; // Vertex and color buffers on GPU
+	size_t capacity = 0; // Number of points GPU buffers can hold
+	size_t uploaded = 0; // Number of points already on GPU
+
+	size_t size() const { return vertices.size() / 3; }
+	void clear() { vertices.clear(); colors.clear(); uploaded = 0; }
+};
+
+/** Trace accumulated so far, extended by one angle slice per frame **/
+struct {
+	bool reset = true; // Should accumulation restart from angle 0
+
+	Points points;
+	std::vector <size_t> offsets; // First point of angle step s is offsets[s], last one is the total
+} trace;
+
+/** Points of the current angle only, streamed each frame **/
+Points current;
+
+/** Append lit samples of all leds of a wheel to a point set
+  * @param [in]  wheel_nr Wheel number
+  * @param [in]  angle    Current angle of the wheel
+  * @param [in]  step     Angle step in trajectory tables matching angle, -1 to compute positions
+  * @param [out] points   Point set to fill
+  */
+void append_leds(int wheel_nr, float angle, int step, Points & points) {
+	// Samples of all bars are looked up in a single batch
+	static thread_local struct {
+		std::vector <float> x, y, z; // Normalized sampling positions
+		std::vector <GLfloat> vertices; // Scene position of each sample
+		std::vector <color> colors; // Sampled colors
+	} batch;
+	batch.x.clear();
+	batch.y.clear();
+	batch.z.clear();
+	batch.vertices.clear();
+
+	for (size_t l = 0; l < emu.leds.size(); ++l) {
+		Led & led = emu.leds[l];
+		if (wheel_nr != led.wheel_nr)
+			continue;
+
+		// Position does not depend on height, compute it once for the whole bar
+		float x, y, nx, ny;
+		size_t column;
+		if (step >= 0 && step < trajectories.steps) {
+			size_t i = l * trajectories.steps + step;
+			nx = trajectories.x[i];
+			ny = trajectories.y[i];
+			x = nx * trajectories.radius;
+			y = ny * trajectories.radius;
+			column = trajectories.column[i];
+		} else {
+			int ix, iy;
+			led_trajectory(emu.a, emu.b, led, trajectories.radius, angle, emu.da, 1, &nx, &ny);
+			x = nx * trajectories.radius;
+			y = ny * trajectories.radius;
+			volume_column(*picture, nx, ny, ix, iy);
+			column = (size_t) ix * picture->size_y + iy;
+		}
+
+		// Scene position is the sampling position with X and Y swapped
+		GLfloat vx = y, vy = x;
+
+		// Skip black columns, and black heights above and below the lit run
+		// Trilinear samples also blend neighbour voxels, so they are all taken
+		int low = 0, high = picture->size_z - 1;
+		if (emu.filter == SAMPLE_NEAREST && !picture->column_min.empty()) {
+			low = picture->column_min[column];
+			high = picture->column_max[column];
+			if (low > high)
 				continue;
+		}
+
+		for (size_t i = 0; i < bars.layers.size(); ++i) {
+			if (bars.layers[i] < low)
+				continue;
+			if (bars.layers[i] > high)
+				break;
+			batch.x.push_back(nx);
+			batch.y.push_back(ny);
+			batch.z.push_back(bars.z[i]);
+			batch.vertices.insert(batch.vertices.end(), {vx, vy, bars.heights[i]});
+		}
+	}
 
-			glBegin(GL_LINES);
-			glVertex3d(0, 0, 0);
-			glVertex3d(
-				led.r * cos(led.alpha * M_PI / 180),
-				led.r * sin(led.alpha * M_PI / 180),
-				0
-			);
-			glEnd();
+	size_t count = batch.z.size();
+	batch.colors.resize(count);
+	if (count)
+		volume_sample(*picture, batch.x.data(), batch.y.data(), batch.z.data(), count, batch.colors.data(), emu.filter);
+	for (size_t i = 0; i < count; ++i) {
+		color c = batch.colors[i];
+		if (c.r || c.g || c.b) {
+			points.vertices.insert(points.vertices.end(), &batch.vertices[i * 3], &batch.vertices[i * 3 + 3]);
+			points.colors.insert(points.colors.end(), {c.r, c.g, c.b});
 		}
 	}
+}
+
+/** Upload a point set to its GPU buffers
+  * @param [in,out] points Point set to upload
+  * @param [in]     usage  Buffer usage hint
+  */
+void upload_points(Points & points, GLenum usage) {
+	if (!points.vbo[0])
+		glGenBuffers(2, points.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, points.vbo[0]);
+	glBufferData(GL_ARRAY_BUFFER, points.vertices.size() * sizeof(GLfloat), points.vertices.data(), usage);
+	glBindBuffer(GL_ARRAY_BUFFER, points.vbo[1]);
+	glBufferData(GL_ARRAY_BUFFER, points.colors.size() * sizeof(GLubyte), points.colors.data(), usage);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	points.capacity = points.size();
+	points.uploaded = points.size();
+}
+
+/** Upload points appended since last upload, growing GPU buffers if needed
+  * @param [in,out] points Point set to upload
+  */
+void upload_new_points(Points & points) {
+	size_t from = points.uploaded;
+	if (from >= points.size())
+		return;
+	if (points.size() > points.capacity) {
+		// Reallocate with room to spare so that next slices fit
+		size_t capacity = std::max(points.size(), 2 * points.capacity);
+		if (!points.vbo[0])
+			glGenBuffers(2, points.vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, points.vbo[0]);
+		glBufferData(GL_ARRAY_BUFFER, capacity * 3 * sizeof(GLfloat), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, points.vbo[1]);
+		glBufferData(GL_ARRAY_BUFFER, capacity * 3 * sizeof(GLubyte), nullptr, GL_DYNAMIC_DRAW);
+		points.capacity = capacity;
+		from = 0;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, points.vbo[0]);
+	glBufferSubData(GL_ARRAY_BUFFER, from * 3 * sizeof(GLfloat), (points.size() - from) * 3 * sizeof(GLfloat), points.vertices.data() + from * 3);
+	glBindBuffer(GL_ARRAY_BUFFER, points.vbo[1]);
+	glBufferSubData(GL_ARRAY_BUFFER, from * 3 * sizeof(GLubyte), (points.size() - from) * 3 * sizeof(GLubyte), points.colors.data() + from * 3);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	points.uploaded = points.size();
+}
+
+/** Draw the first points of a point set from its GPU buffers
+  * @param [in] points Point set to draw
+  * @param [in] count  Number of points to draw
+  */
+void draw_points(const Points & points, size_t count) {
+	if (!count || !points.vbo[0])
+		return;
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, points.vbo[0]);
+	glVertexPointer(3, GL_FLOAT, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, points.vbo[1]);
+	glColorPointer(3, GL_UNSIGNED_BYTE, 0, 0);
+	glDrawArrays(GL_POINTS, 0, count);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+/** Extend the trace up to a given angle, restarting it on wrap-around or parameters change
+  * @param [in] angle Angle the trace should reach
+  */
+void update_trace(float angle) {
+	bool changed = update_trajectories();
+	changed = update_bars() || changed;
+	update_occupancy();
+	int steps = (emu.da > 0 && angle > 0) ? std::min<float>(ceil(angle / emu.da), trajectories.steps) : 0;
+
+	int built = trace.offsets.size() - 1;
+	if (changed || trace.reset || steps < built) {
+		trace.reset = false;
+		trace.points.clear();
+		trace.offsets.assign(1, 0);
+		built = 0;
+	}
+
+	if (steps <= built || emu.nr <= 0)
+		return;
 
-	// Draw leds
-	static float max_x = 1, max_y = 1;
+	// Sample new steps in parallel, by chunk of angle steps and by wheel
+	struct Part {
+		Points points;
+		std::vector <size_t> ends; // End of each angle step in points
+	};
+	int chunk = std::max<int>(1, (steps - built) / (4 * workers.pool->size()));
+	int chunks = (steps - built + chunk - 1) / chunk;
+	std::vector <Part> parts(chunks * emu.nr);
+	workers.pool->parallel_for(parts.size(), 1, [&] (size_t begin, size_t end) {
+		for (size_t p = begin; p < end; ++p) {
+			int n = p % emu.nr;
+			int first = built + (p / emu.nr) * chunk;
+			int last = std::min(first + chunk, steps);
+			for (int s = first; s < last; ++s) {
+				append_leds(n, wheel_angle(s, emu.da, n, emu.nr), s, parts[p].points);
+				parts[p].ends.push_back(parts[p].points.size());
+			}
+		}
+	});
+
+	// Merge them in angle step order, then wheel order
+	for (int c = 0; c < chunks; ++c) {
+		int first = built + c * chunk;
+		int last = std::min(first + chunk, steps);
+		for (int i = 0; i < last - first; ++i) {
+			for (int n = 0; n < emu.nr; ++n) {
+				Part & part = parts[c * emu.nr + n];
+				size_t from = i ? part.ends[i - 1] : 0, to = part.ends[i];
+				trace.points.vertices.insert(trace.points.vertices.end(), part.points.vertices.begin() + from * 3, part.points.vertices.begin() + to * 3);
+				trace.points.colors.insert(trace.points.colors.end(), part.points.colors.begin() + from * 3, part.points.colors.begin() + to * 3);
+			}
+			trace.offsets.push_back(trace.points.size());
+		}
+	}
+}
+
+/** Compute led points to show for current animation state
+  * @return Point set to draw
+  */
+Points & update_leds() {
+	if (emu.trace) {
+		update_trace(ani * emu.turns * 360);
+		return trace.points;
+	}
+
+	float a = ani * emu.turns * 360;
+	update_trajectories();
+	update_bars();
+	update_occupancy();
+	current.clear();
+	for (int n = 0; n < emu.nr; ++n)
+		append_leds(n, a + 360 * n / emu.nr, -1, current);
+	return current;
+}
+
+/** Give angle at which wheels should be drawn for current animation state
+  * @param [out] angle Angle of first wheel
+  * @return false if wheels should not be drawn
+  */
+bool wheels_angle(float & angle) {
+	if (!emu.trace) {
+		angle = ani * emu.turns * 360;
+		return true;
+	}
+	int s = trace.offsets.size() - 1;
+	angle = (s - 1) * emu.da;
+	return s > 0;
+}
+
+/** Build a circle in z = 0 plane
+  * @param [in]  x        X position of center
+  * @param [in]  y        Y position of center
+  * @param [in]  r        Radius
+  * @param [out] vertices X, Y, Z of each point of the circle
+  */
+void circle_outline(float x, float y, float r, std::vector <float> & vertices) {
+	int circle_pts = r * 9;
+	vertices.clear();
+	for (int i = 0; i < circle_pts; ++i)
+		vertices.insert(vertices.end(), {
+			float(x + r * cos(i * 2 * M_PI / circle_pts)),
+			float(y + r * sin(i * 2 * M_PI / circle_pts)),
+			0
+		});
+}
+
+/** Build outline of a wheel and its led bars
+  * @param [in]  wheel_nr Wheel number
+  * @param [in]  angle    Current angle of the wheel
+  * @param [out] circle   X, Y, Z of each point of the wheel circle
+  * @param [out] bars     X, Y, Z of both ends of each led bar
+  */
+void wheel_outline(int wheel_nr, float angle, std::vector <float> & circle, std::vector <float> & bars) {
+	// Wheel center turns around inner circle, and wheel turns around its center
+	float cx = (emu.a + emu.b) * cos_deg(angle);
+	float cy = (emu.a + emu.b) * sin_deg(angle);
+	float rotation = angle * (emu.a+emu.b)/(emu.b);
+
+	circle_outline(cx, cy, emu.b, circle);
+	bars.clear();
 	for (Led & led: emu.leds) {
 		if (wheel_nr != led.wheel_nr)
 			continue;
 
-		glBegin(GL_POINTS);
-		for (float h = 0; h <= emu.h; h += emu.dh) {
-			float x, y, z;
-			color c;
-			// Hum, there is probably a better way to compute sin/cos with matrix since we do it in incremental way
-			x = (emu.a + emu.b) * sin(angle * M_PI / 180 ) + led.r * sin(((emu.a+emu.b)/(emu.b) * angle + led.alpha) * M_PI / 180);
-			y = (emu.a + emu.b) * cos(angle * M_PI / 180 ) + led.r * cos(((emu.a+emu.b)/(emu.b) * angle + led.alpha) * M_PI / 180);
-			if (fabs(x) > max_x) max_x = fabs(x);
-			if (fabs(y) > max_y) max_y = fabs(y);
-			x /= max_x;
-			y /= max_y;
-			z = (emu.h > 0) ? h / emu.h : h;
-			c = color_chooser(x, y, z);
-			if (c.r || c.g || c.b) {
-				glColor3d(c.r*(1.0/255), c.g*(1.0/255), c.b*(1.0/255));
-				glVertex3d(
-					led.r * cos(led.alpha * M_PI / 180),
-					led.r * sin(led.alpha * M_PI / 180),
-					h
-				);
-			}
-		}
-		glEnd();
+		bars.insert(bars.end(), {
+			cx, cy, 0,
+			cx + led.r * cos_deg(rotation + led.alpha),
+			cy + led.r * sin_deg(rotation + led.alpha),
+			0
+		});
 	}
+}
 
-	glPopMatrix();
+/** Draw vertices with OpenGL
+  * @param [in] mode     Primitive to draw
+  * @param [in] vertices X, Y, Z of each vertex
+  */
+void draw_vertices(GLenum mode, const std::vector <float> & vertices) {
+	glBegin(mode);
+	for (size_t i = 0; i + 2 < vertices.size(); i += 3)
+		glVertex3f(vertices[i], vertices[i + 1], vertices[i + 2]);
+	glEnd();
+}
+
+/** Render scene with the software renderer, as display() does with OpenGL
+  * @param [in,out] fb Framebuffer to render to
+  */
+void render_soft(Framebuffer & fb) {
+	const uint8_t ground_from[3] = {179, 179, 179}, ground_to[3] = {255, 255, 255};
+	const uint8_t circle_a_color[3] = {0, 77, 0}, wheel_color[3] = {0, 0, 77};
+
+	soft_camera(fb, camera.distance, camera.angle_y, camera.angle_z);
+	soft_clear(fb);
+	soft_ground(fb, 10, ground_from, ground_to);
+
+	std::vector <float> circle, bars;
+	circle_outline(0, 0, emu.a, circle);
+	soft_lines(fb, circle.data(), circle.size() / 3, circle_a_color, true);
+
+	Points & points = update_leds();
+	soft_points(fb, points.vertices.data(), points.colors.data(), points.size(), 3);
+
+	float a;
+	if (wheels_angle(a)) {
+		for (int n = 0; n < emu.nr; ++n) {
+			wheel_outline(n, a + 360 * n / emu.nr, circle, bars);
+			soft_lines(fb, circle.data(), circle.size() / 3, wheel_color, true);
+			soft_lines(fb, bars.data(), bars.size() / 3, wheel_color, false);
+		}
+	}
 }
 
 /** Display function called to redraw scene **/
 void display() {
+	// Software renderer only needs its frame to be copied to window
+	if (software.enabled) {
+		render_soft(software.fb);
+		glDisable(GL_DEPTH_TEST);
+		glWindowPos2i(0, 0);
+		glDrawPixels(software.fb.width, software.fb.height, GL_RGB, GL_UNSIGNED_BYTE, software.fb.pixels.data());
+		glEnable(GL_DEPTH_TEST);
+		glFlush();
+		glutSwapBuffers();
+		return;
+	}
+
 	// Init
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glMatrixMode(GL_MODELVIEW);
@@ -187,28 +561,27 @@ void display() {
 	glEnd();
 
 	// Circle A
-	int circle_pts = emu.a * 9;
-	glBegin(GL_LINE_LOOP);
+	std::vector <float> circle, bars;
+	circle_outline(0, 0, emu.a, circle);
 	glColor3d(0, 0.3f, 0);
-	for (int i = 0; i < circle_pts; ++i)
-		glVertex3d(
-			emu.a * cos(i * 2 * M_PI / circle_pts),
-			emu.a * sin(i * 2 * M_PI / circle_pts),
-			0
-		);
-	glEnd();
+	draw_vertices(GL_LINE_LOOP, circle);
 
 	// Leds
-	if (emu.trace) {
-		for (float a = 0; a < ani * emu.turns * 360; a += emu.da) {
-			for (int n = 0; n < emu.nr; ++n) {
-				draw_leds(n, a + 360 * n / emu.nr, ((a + emu.da) > (ani * emu.turns * 360)));
-			}
-		}
-	} else {
-		float a = ani * emu.turns * 360;
+	Points & points = update_leds();
+	if (&points == &trace.points)
+		upload_new_points(points);
+	else
+		upload_points(points, GL_STREAM_DRAW);
+	draw_points(points, points.size());
+
+	// Wheels
+	float a;
+	if (wheels_angle(a)) {
+		glColor3d(0, 0, 0.3f);
 		for (int n = 0; n < emu.nr; ++n) {
-			draw_leds(n, a + 360 * n / emu.nr, ((a + emu.da) > (ani * emu.turns * 360)));
+			wheel_outline(n, a + 360 * n / emu.nr, circle, bars);
+			draw_vertices(GL_LINE_LOOP, circle);
+			draw_vertices(GL_LINES, bars);
 		}
 	}
 
@@ -221,11 +594,14 @@ void display() {
 void reshape(int width, int height) {
 	screen.width = width;
 	screen.height = height;
+	if (software.enabled)
+		soft_init(software.fb, screen.width, screen.height);
 	glViewport(0, 0, screen.width, screen.height);
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 	gluPerspective(70, (double) screen.width / screen.height, 1, 1000);
-	glMatrixMode(GL_DEPTH_TEST);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
 }
 
 /** Passive motion function called when mouse moves **/
@@ -246,30 +622,70 @@ void keyboard(unsigned char key, int x, int y) {
 	if (key == 27) // escape
 		exit(0);
 	else if (key == 111) // o
-		emu.animated = false, emu.trace = true, ani = 1;
+		emu.animated = false, emu.trace = true, ani = 1, trace.reset = true;
 	else if (key == 116) // t
-		emu.trace = !emu.trace;
+		emu.trace = !emu.trace, trace.reset = true;
+	else if (key == 102) // f
+		emu.filter = (emu.filter == SAMPLE_NEAREST) ? SAMPLE_TRILINEAR : SAMPLE_NEAREST, trace.reset = true;
 	else if (key == 32) // space
 		emu.animated = !emu.animated;
 }
 
+/** Advance animation and picture sequence by one frame
+  * @param [in] wait Wait for next picture of sequence if it is not read yet, instead of showing it later
+  */
+void advance(bool wait) {
+	if (emu.animated) {
+		ani += 0.01 / emu.turns;
+		if (ani > 1)
+			ani = 0;
+	}
+
+	if (playback.enabled) {
+		playback.elapsed_ms += anim_intervalle * 1e-6;
+		if (playback.elapsed_ms >= playback.sequence.frame_ms && sequence_next(playback.sequence, wait)) {
+			playback.elapsed_ms = std::min<float>(playback.elapsed_ms - playback.sequence.frame_ms, playback.sequence.frame_ms);
+			picture = &sequence_frame(playback.sequence);
+			trace.reset = true;
+		}
+	}
+}
+
 /** Idle function used to limit framerate **/
 void idle() {
-	float anim_intervalle = 40e6;
 	wakeup.tv_nsec += anim_intervalle;
 	if (wakeup.tv_nsec > 1e9) {
 		wakeup.tv_nsec -= 1e9;
 		wakeup.tv_sec += 1;
 	}
         clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL);
-	if (emu.animated) {
-		ani += 0.01 / emu.turns;
-		if (ani > 1)
-			ani = 0;
-	}
+	advance(false);
 	glutPostRedisplay();
 }
 
+/** Render frames to PPM files without any window
+  * @return 0 on success
+  */
+int run_headless() {
+	mkdir(headless.out.c_str(), 0777);
+
+	Framebuffer & fb = software.fb;
+	soft_init(fb, screen.width, screen.height);
+	for (int i = 0; i < headless.frames; ++i) {
+		if (i)
+			advance(true);
+		render_soft(fb);
+
+		char filename[32];
+		snprintf(filename, sizeof(filename), "/frame%05d.ppm", i);
+		if (!soft_write_ppm(fb, (headless.out + filename).c_str())) {
+			std::cerr << "ERROR cannot write " << headless.out << filename << std::endl;
+			return 3;
+		}
+	}
+	return 0;
+}
+
 /** Print usage message **/
 void usage() {
 	std::cout << "This is a little AziPOV emulator" << std::endl
@@ -278,6 +694,12 @@ void usage() {
 	          << "    --width <w>     starts window with a specified width" << std::endl
 	          << "    --height <h>    starts window with a specified height" << std::endl
 	          << "    --turns <t>     number of turns to show" << std::endl
+	          << "    --headless      render frames to files instead of opening a window" << std::endl
+	          << "    --frames <n>    number of frames to render in headless mode" << std::endl
+	          << "    --out <dir>     directory where headless frames are written" << std::endl
+	          << "    --soft          render window with the software renderer instead of OpenGL" << std::endl
+	          << "    --threads <n>   number of worker threads (default: one per core)" << std::endl
+	          << "    --smooth        blend picture voxels around leds instead of taking nearest one" << std::endl
 	          << std::endl
 	          << "    --da <da>       angular resolution in degrees" << std::endl
 	          << "    --a <a>         size of inner wheel" << std::endl
@@ -287,7 +709,7 @@ void usage() {
 	          << "    --nr <nr>       number of wheels" << std::endl
 	          << std::endl
 	          << "    --led|-l <led>  add a led (see below)" << std::endl
-	          << "    --pic|-p <p>    read from picture file p" << std::endl
+	          << "    --pic|-p <p>    read from picture file p, or play it if it is a sequence" << std::endl
 	          << std::endl
 	          << std::endl
 	          << "A led is described in following syntax: [wheel:]radius[@angle]" << std::endl
@@ -298,6 +720,7 @@ void usage() {
 	          << "Orientation is chosen by draging mouse on window" << std::endl
 	          << "Zoom is chosen by clicking on window (more zoom on top of window)" << std::endl
 	          << "Key \"t\" changes trace status" << std::endl
+	          << "Key \"f\" changes picture sampling between nearest and smooth" << std::endl
 	          << "Key \"o\" stops animation with trace at 100%" << std::endl
 	          << "Key \"ESC\" closes emulator" << std::endl
 	          << "Key \"SPACE\" changes animation status" << std::endl
@@ -320,14 +743,8 @@ int parse_options(int argc, char * argv[]) {
 	emu.b = 2.5;
 	emu.dh = 0.7;
 	emu.h = 11.2;
-	for (int ix = 0; ix < PICTURE_X; ++ix) {
-		for (int iy = 0; iy < PICTURE_Y; ++iy) {
-			for (int iz = 0; iz < PICTURE_Z; ++iz) {
-				color c = {255, 0, 0};
-				picture[ix][iy][iz] = c;
-			}
-		}
-	}
+	emu.filter = SAMPLE_NEAREST;
+	volume_fill(still, 24, 24, 24, {255, 0, 0});
 	struct option generic_options[] = {
 		{"animated", no_argument, 0, 0x01},
 		{"no-trace", no_argument, 0, 0x02},
@@ -335,6 +752,12 @@ int parse_options(int argc, char * argv[]) {
 		{"height", required_argument, 0, 0x04},
 		{"turns", required_argument, 0, 0x07},
 		{"help", no_argument, 0, 0x08},
+		{"headless", no_argument, 0, 0x09},
+		{"frames", required_argument, 0, 0x0a},
+		{"out", required_argument, 0, 0x0b},
+		{"soft", no_argument, 0, 0x0c},
+		{"threads", required_argument, 0, 0x0d},
+		{"smooth", no_argument, 0, 0x0e},
 
 		{"da", required_argument, 0, 0x05},
 		{"a", required_argument, 0, 'a'},
@@ -390,6 +813,24 @@ int parse_options(int argc, char * argv[]) {
 			usage();
 			return 2;
 
+		} else if (c == 0x09) {
+			headless.enabled = true;
+
+		} else if (c == 0x0a && optvalul) {
+			headless.frames = optvalul;
+
+		} else if (c == 0x0b) {
+			headless.out = optarg;
+
+		} else if (c == 0x0c) {
+			software.enabled = true;
+
+		} else if (c == 0x0d) {
+			workers.threads = optvalul;
+
+		} else if (c == 0x0e) {
+			emu.filter = SAMPLE_TRILINEAR;
+
 		} else if (c == 'a') {
 			emu.a = optvalf;
 
@@ -400,28 +841,8 @@ int parse_options(int argc, char * argv[]) {
 			emu.nr = optvalul;
 
 		} else if (c == 'l') {
-			char *str, *t1, *t2, *t3;
-			str = optarg;
-			t1 = strpbrk(str, ":");
-			if (t1) {
-				*t1 = 0;
-				str = t1 + 1;
-				t1 = optarg;
-			}
-			t2 = strpbrk(str, "@");
-			if (t2) {
-				*t2 = 0;
-				t3 = t2 + 1;
-				t2 = str;
-			} else {
-				t2 = str;
-				t3 = 0;
-			}
-
 			Led l;
-			l.wheel_nr = (!t1 || !*t1) ? 0 : strtoul(t1, NULL, 10);
-			l.r = (!t2 || !*t2) ? emu.b : strtof(t2, NULL);
-			l.alpha = (!t3 || !*t3) ? 0 : strtof(t3, NULL);
+			led_parse(optarg, emu.b, l);
 			emu.leds.push_back(l);
 		} else if (c == 'p') {
 			if (picturename != nullptr)
@@ -430,34 +851,17 @@ int parse_options(int argc, char * argv[]) {
 		}
 	}
 
-	if (emu.leds.size() == 0) {
-		for (int n = 0; n < emu.nr; ++n) {
-			Led l;
-			const float dephasage = 76;
-			l.wheel_nr = n;
-			l.r = emu.a + emu.b;
-			l.alpha = 0 + n * dephasage / emu.nr;
-			emu.leds.push_back(l);
-			l.alpha = 120 + n * dephasage / emu.nr;
-			emu.leds.push_back(l);
-			l.alpha = 240 + n * dephasage / emu.nr;
-			emu.leds.push_back(l);
-		}
-	}
+	if (emu.leds.size() == 0)
+		leds_default(emu.nr, emu.a, emu.b, emu.leds);
 
 	if (picturename != nullptr) {
-		int x, y, z;
-		std::ifstream f(picturename);
-		for (x = 0; x < PICTURE_X; ++x) {
-			for (y = 0; y < PICTURE_Y; ++y) {
-				for (z = 0; z < PICTURE_Z; ++z) {
-					picture[x][y][z].r = f.get();
-					picture[x][y][z].g = f.get();
-					picture[x][y][z].b = f.get();
-				}
-			}
+		if (sequence_open(playback.sequence, picturename)) {
+			playback.enabled = true;
+			picture = &sequence_frame(playback.sequence);
+		} else if (!volume_load(still, picturename)) {
+			std::cerr << "ERROR cannot read picture " << picturename << std::endl;
+			return 3;
 		}
-		f.close();
 	}
 
 	return 0;
@@ -478,6 +882,13 @@ int main(int argc, char * argv[]) {
 	          << "h: " << emu.h << std::endl
 	          << "nr: " << emu.nr << std::endl;
 
+	// Worker threads
+	ThreadPool pool(workers.threads);
+	workers.pool = &pool;
+	software.fb.pool = &pool;
+	if (headless.enabled)
+		return run_headless();
+
 	// Init glut
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
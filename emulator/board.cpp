@@ -0,0 +1,183 @@
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <getopt.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "store.h"
+#include "upload.h"
+
+/** Board standing in: flash of the content store and options **/
+struct Board {
+	std::vector <uint8_t> flash; // Content store region, 0xff when erased
+	const char * out; // File to write uploaded stores to
+	int fd; // Master side of pseudo terminal
+	bool once; // Quit after first upload
+	bool done; // Host was told an upload finished
+	bool lose_end; // Lose acknowledgement of upload end, once per upload
+	bool lost; // Acknowledgement of upload end was lost
+	struct upload_receiver * receiver; // Protocol state
+};
+
+/** Erase flash, as the firmware does before an upload **/
+int erase(void * context, uint32_t size) {
+	Board * board = (Board *) context;
+	if (size > board->flash.size())
+		return UPLOAD_TOO_LARGE;
+	board->lost = false;
+	std::fill(board->flash.begin(), board->flash.end(), 0xff);
+	return UPLOAD_OK;
+}
+
+/** Program flash, which only turns bits from 1 to 0 **/
+int program(void * context, uint32_t offset, const uint8_t * data, uint32_t length) {
+	Board * board = (Board *) context;
+	for (uint32_t i = 0; i < length; ++i) {
+		if ((board->flash[offset + i] & data[i]) != data[i])
+			return UPLOAD_FLASH_ERROR;
+		board->flash[offset + i] = data[i];
+	}
+	return UPLOAD_OK;
+}
+
+/** Check uploaded store and write it out **/
+int finish(void * context, uint32_t size, uint32_t crc) {
+	Board * board = (Board *) context;
+	const struct store_header * header = (const struct store_header *) board->flash.data();
+	if (size < sizeof(*header) || header->size != size || store_crc32(0, header, size) != crc ||
+	    !store_check(header, board->flash.size(), 1))
+		return UPLOAD_BAD_IMAGE;
+	std::cout << "store of " << size << " bytes, " << header->entries << " contents" << std::endl;
+	if (board->out) {
+		std::ofstream f(board->out, std::ios::binary);
+		f.write((const char *) header, size);
+		if (!f)
+			std::cerr << "ERROR cannot write " << board->out << std::endl;
+	}
+	return UPLOAD_OK;
+}
+
+/** Send bytes to host **/
+void send(void * context, const uint8_t * frame, size_t length) {
+	Board * board = (Board *) context;
+	if (board->receiver->finished && board->receiver->status == UPLOAD_OK) {
+		// Host has to send frames again until it hears of the end
+		if (board->lose_end && !board->lost) {
+			board->lost = true;
+			return;
+		}
+		board->done = true;
+	}
+	while (length) {
+		ssize_t n = write(board->fd, frame, length);
+		if (n < 0)
+			return;
+		frame += n;
+		length -= n;
+	}
+}
+
+/** Print usage message **/
+void usage() {
+	std::cout << "Stands in for the board on a pseudo terminal, to try azipov_upload without hardware" << std::endl
+	          << "    --out|-o <f>    file to write each uploaded store to" << std::endl
+	          << "    --max <bytes>   size of flash for the store (default 393216, as on the F401RE)" << std::endl
+	          << "    --noise <n>     corrupt one received byte out of n (default 0, none)" << std::endl
+	          << "    --once          quit after first upload" << std::endl
+	          << "    --lose-end      lose acknowledgement of each upload end once" << std::endl
+	          << std::endl
+	          << "Sample command line: -o received.azpd --noise 20000" << std::endl;
+}
+
+/** Main function used as entry point **/
+int main(int argc, char * argv[]) {
+	Board board = {std::vector <uint8_t> (384 * 1024, 0xff), nullptr, -1, false, false, false, false, nullptr};
+	unsigned long noise = 0;
+	int c;
+	int option_index = 0;
+	struct option options[] = {
+		{"out", required_argument, 0, 'o'},
+		{"help", no_argument, 0, 0x01},
+		{"max", required_argument, 0, 0x02},
+		{"noise", required_argument, 0, 0x03},
+		{"once", no_argument, 0, 0x04},
+		{"lose-end", no_argument, 0, 0x05},
+		{0, 0, 0, 0}
+	};
+	while((c = getopt_long(argc, argv, "o:", options, &option_index)) != -1) {
+		if (c == 'o') {
+			board.out = optarg;
+		} else if (c == 0x01) {
+			usage();
+			return 2;
+		} else if (c == 0x02) {
+			board.flash.assign(strtoul(optarg, NULL, 10), 0xff);
+		} else if (c == 0x03) {
+			noise = strtoul(optarg, NULL, 10);
+		} else if (c == 0x04) {
+			board.once = true;
+		} else if (c == 0x05) {
+			board.lose_end = true;
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (optind != argc) {
+		usage();
+		return 1;
+	}
+
+	board.fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (board.fd < 0 || grantpt(board.fd) < 0 || unlockpt(board.fd) < 0) {
+		std::cerr << "ERROR cannot create a pseudo terminal" << std::endl;
+		return 3;
+	}
+	// Keep slave side open so that reads do not fail between uploads
+	const char * name = ptsname(board.fd);
+	int slave = open(name, O_RDWR | O_NOCTTY);
+	struct termios tio;
+	if (slave < 0 || tcgetattr(slave, &tio) < 0) {
+		std::cerr << "ERROR cannot open " << name << std::endl;
+		return 3;
+	}
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+	std::cout << name << std::endl;
+
+	struct upload_receiver receiver;
+	memset(&receiver, 0, sizeof(receiver));
+	receiver.context = &board;
+	board.receiver = &receiver;
+	receiver.erase = erase;
+	receiver.program = program;
+	receiver.finish = finish;
+	receiver.send = send;
+
+	uint8_t buffer[4096];
+	unsigned long received = 0;
+	srand(1);
+	for (;;) {
+		// Frames sent again may still be coming after the end, quit once the link is quiet
+		struct pollfd p = {board.fd, POLLIN, 0};
+		if (board.once && board.done && poll(&p, 1, 1000) == 0)
+			break;
+		ssize_t n = read(board.fd, buffer, sizeof(buffer));
+		if (n < 0) {
+			std::cerr << "ERROR cannot read " << name << std::endl;
+			return 3;
+		}
+		for (ssize_t i = 0; i < n; ++i) {
+			if (noise && ++received % noise == 0)
+				buffer[rand() % n] ^= 0x10;
+		}
+		upload_receive(&receiver, buffer, n);
+	}
+	close(slave);
+	close(board.fd);
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include "geometry.h"
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "sintable.h"
+#include "rotation.h"
+
+/** Sine table of geometry, fine enough for linear interpolation to stay below voxel size **/
+typedef SinTable <4096, int32_t, 30> Sines;
+
+void led_parse(char * str, float b, Led & led) {
+	char *t1, *t2, *t3;
+	char * start = str;
+	t1 = strpbrk(str, ":");
+	if (t1) {
+		*t1 = 0;
+		str = t1 + 1;
+		t1 = start;
+	}
+	t2 = strpbrk(str, "@");
+	if (t2) {
+		*t2 = 0;
+		t3 = t2 + 1;
+		t2 = str;
+	} else {
+		t2 = str;
+		t3 = 0;
+	}
+
+	led.wheel_nr = (!t1 || !*t1) ? 0 : strtoul(t1, NULL, 10);
+	led.r = (!t2 || !*t2) ? b : strtof(t2, NULL);
+	led.alpha = (!t3 || !*t3) ? 0 : strtof(t3, NULL);
+}
+
+void leds_default(int nr, float a, float b, std::vector <Led> & leds) {
+	for (int n = 0; n < nr; ++n) {
+		Led l;
+		const float dephasage = 76;
+		l.wheel_nr = n;
+		l.r = a + b;
+		l.alpha = 0 + n * dephasage / nr;
+		leds.push_back(l);
+		l.alpha = 120 + n * dephasage / nr;
+		leds.push_back(l);
+		l.alpha = 240 + n * dephasage / nr;
+		leds.push_back(l);
+	}
+}
+
+float wheel_angle(int step, float da, int wheel_nr, int nr) {
+	return step * da + 360 * wheel_nr / nr;
+}
+
+/** Interpolate table between two steps
+  * @param [in] degrees Angle in degrees
+  * @param [in] quarter 0 for sine, a quarter of turn in steps for cosine
+  * @return Interpolated value
+  */
+static float interpolate(float degrees, unsigned quarter) {
+	double position = degrees * (Sines::steps / 360.0);
+	double step = floor(position);
+	float t = position - step;
+	unsigned i = (unsigned) (long long) step + quarter;
+	float v0 = Sines::sin(i), v1 = Sines::sin(i + 1);
+	return (v0 + (v1 - v0) * t) * (1.0f / (1 << Sines::bits));
+}
+
+float sin_deg(float degrees) {
+	return interpolate(degrees, 0);
+}
+
+float cos_deg(float degrees) {
+	return interpolate(degrees, Sines::steps / 4);
+}
+
+void led_trajectory(float a, float b, const Led & led, float radius, float start, float da, size_t steps, float * nx, float * ny) {
+	EpicycloidTracker <> tracker;
+	tracker.seed(a, b, led.r, led.alpha, radius, start, da);
+	for (size_t s = 0; s < steps; ++s, tracker.tick()) {
+		nx[s] = tracker.x() * (1.0f / EpicycloidTracker <>::one);
+		ny[s] = tracker.y() * (1.0f / EpicycloidTracker <>::one);
+	}
+}
+
+float trajectory_radius(float a, float b, const std::vector <Led> & leds) {
+	float r = 0;
+	for (const Led & led: leds)
+		r = std::max(r, fabsf(led.r));
+	return std::max(1.0f, fabsf(a + b) + r);
+}
+
+void bar_heights(float dh, float h, std::vector <float> & heights, std::vector <float> & z) {
+	heights.clear();
+	z.clear();
+	for (float v = 0; v <= h && dh > 0; v += dh) {
+		heights.push_back(v);
+		z.push_back((h > 0) ? v / h : v);
+	}
+}
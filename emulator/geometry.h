@@ -0,0 +1,82 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <vector>
+#include <cstddef>
+
+/** Led bar mounted on a wheel **/
+struct Led {
+	int wheel_nr; // Number of wheel on which the led bar is present
+	float r; // Radius of led bar position
+	float alpha; // Angle of lef bar position
+};
+
+/** Parse a led description, in [wheel:]radius[@angle] syntax
+  * @param [in]  str Description, modified while parsing
+  * @param [in]  b   Radius of outer circle, used as default led radius
+  * @param [out] led Parsed led
+  */
+void led_parse(char * str, float b, Led & led);
+
+/** Give the default leds, three bars per wheel
+  * @param [in]  nr   Number of wheels
+  * @param [in]  a    Radius of inner circle
+  * @param [in]  b    Radius of outer circle
+  * @param [out] leds Leds of all wheels
+  */
+void leds_default(int nr, float a, float b, std::vector <Led> & leds);
+
+/** Give angle of a wheel at an angle step
+  * @param [in] step     Angle step
+  * @param [in] da       Angular step in degrees
+  * @param [in] wheel_nr Wheel number
+  * @param [in] nr       Number of wheels
+  * @return Angle of wheel in degrees
+  */
+float wheel_angle(int step, float da, int wheel_nr, int nr);
+
+/** Give sine of an angle, from a fixed point table
+  * @param [in] degrees Angle in degrees
+  * @return Sine of angle
+  */
+float sin_deg(float degrees);
+
+/** Give cosine of an angle, from a fixed point table
+  * @param [in] degrees Angle in degrees
+  * @return Cosine of angle
+  */
+float cos_deg(float degrees);
+
+/** Follow a led along its epicycloid, one angle step after the other
+  * Uses the fixed point engine of rotation.h, the one path from led angles to
+  * positions for the slicer and the emulator.
+  * @param [in]  a      Radius of inner circle
+  * @param [in]  b      Radius of outer circle
+  * @param [in]  led    Led to follow
+  * @param [in]  radius Bound of led distance to center, from trajectory_radius()
+  * @param [in]  start  Angle of the wheel at first step
+  * @param [in]  da     Angular step in degrees
+  * @param [in]  steps  Number of angle steps
+  * @param [out] nx     Normalized X position at each step
+  * @param [out] ny     Normalized Y position at each step
+  */
+void led_trajectory(float a, float b, const Led & led, float radius, float start, float da, size_t steps, float * nx, float * ny);
+
+/** Give bound of led distance to center, from wheel sizes and led radii
+  * Each led is at most at a + b from center plus its radius, whatever the angle
+  * @param [in] a    Radius of inner circle
+  * @param [in] b    Radius of outer circle
+  * @param [in] leds Leds of all wheels
+  * @return Bound, at least 1
+  */
+float trajectory_radius(float a, float b, const std::vector <Led> & leds);
+
+/** Give sampled heights along led bars
+  * @param [in]  dh      Height step
+  * @param [in]  h       Length of led bars
+  * @param [out] heights Height of each sample
+  * @param [out] z       Normalized height of each sample, in 0..1 range
+  */
+void bar_heights(float dh, float h, std::vector <float> & heights, std::vector <float> & z);
+
+#endif // GEOMETRY_H
@@ -0,0 +1,135 @@
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <getopt.h>
+#include "volume.h"
+#include "sequence.h"
+
+/** Write a little endian value
+  * @param [out] f     Stream to write to
+  * @param [in]  v     Value
+  * @param [in]  bytes Size of value in bytes
+  */
+void write_le(std::ostream & f, uint64_t v, int bytes) {
+	for (int i = 0; i < bytes; ++i)
+		f.put((v >> (8 * i)) & 0xff);
+}
+
+/** Print usage message **/
+void usage() {
+	std::cout << "Packs AziPOV volumes into a sequence file" << std::endl
+	          << "    --out|-o <f>    sequence file to create" << std::endl
+	          << "    --ms <ms>       duration of each frame in milliseconds (default 40)" << std::endl
+	          << "    --rle           run-length encode frames, for mostly black volumes" << std::endl
+	          << "    --still         write a single volume instead of a sequence" << std::endl
+	          << std::endl
+	          << "Sample command line: -o anim.azpa --ms 80 frame0.raw frame1.raw frame2.raw" << std::endl
+	          << "                     -o star.azpr --rle --still star.raw" << std::endl;
+}
+
+/** Main function used as entry point **/
+int main(int argc, char * argv[]) {
+	const char * out = nullptr;
+	unsigned frame_ms = 40;
+	bool rle = false;
+	bool still = false;
+	int c;
+	int option_index = 0;
+	struct option options[] = {
+		{"out", required_argument, 0, 'o'},
+		{"ms", required_argument, 0, 0x01},
+		{"help", no_argument, 0, 0x02},
+		{"rle", no_argument, 0, 0x03},
+		{"still", no_argument, 0, 0x04},
+		{0, 0, 0, 0}
+	};
+	while((c = getopt_long(argc, argv, "o:", options, &option_index)) != -1) {
+		if (c == 'o') {
+			out = optarg;
+		} else if (c == 0x01) {
+			frame_ms = strtoul(optarg, NULL, 10);
+		} else if (c == 0x02) {
+			usage();
+			return 2;
+		} else if (c == 0x03) {
+			rle = true;
+		} else if (c == 0x04) {
+			still = true;
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!out || optind >= argc || (still && optind + 1 != argc)) {
+		usage();
+		return 1;
+	}
+
+	// Check all frames before writing anything
+	int frames = argc - optind;
+	Volume volume;
+	int x = 0, y = 0, z = 0;
+	for (int i = 0; i < frames; ++i) {
+		const char * name = argv[optind + i];
+		if (!volume_load(volume, name)) {
+			std::cerr << "ERROR cannot read volume " << name << std::endl;
+			return 3;
+		}
+		if (i == 0) {
+			x = volume.size_x;
+			y = volume.size_y;
+			z = volume.size_z;
+		} else if (volume.size_x != x || volume.size_y != y || volume.size_z != z) {
+			std::cerr << "ERROR " << name << " has not the same size as first volume" << std::endl;
+			return 3;
+		}
+	}
+
+	// Encode all frames
+	std::vector <std::vector <unsigned char>> data(frames);
+	for (int i = 0; i < frames; ++i) {
+		volume_load(volume, argv[optind + i]);
+		size_t count = (size_t) x * y * z;
+		if (rle)
+			volume_encode_rle(volume.voxels, count, data[i]);
+		else
+			data[i].assign((const unsigned char *) volume.voxels, (const unsigned char *) (volume.voxels + count));
+	}
+
+	std::ofstream f(out, std::ios::binary);
+	if (still) {
+		f.write(rle ? VOLUME_RLE_MAGIC : VOLUME_MAGIC, 4);
+		write_le(f, VOLUME_VERSION, 2);
+		write_le(f, x, 2);
+		write_le(f, y, 2);
+		write_le(f, z, 2);
+		f.write((const char *) data[0].data(), data[0].size());
+	} else {
+		f.write(SEQUENCE_MAGIC, 4);
+		write_le(f, SEQUENCE_VERSION, 2);
+		write_le(f, x, 2);
+		write_le(f, y, 2);
+		write_le(f, z, 2);
+		write_le(f, frames, 4);
+		write_le(f, frame_ms, 2);
+		write_le(f, 0, 2);
+
+		uint64_t offset = SEQUENCE_HEADER_SIZE + (uint64_t) frames * SEQUENCE_ENTRY_SIZE;
+		for (int i = 0; i < frames; ++i) {
+			write_le(f, offset, 8);
+			write_le(f, data[i].size(), 4);
+			write_le(f, rle ? SEQUENCE_RLE : SEQUENCE_RAW, 4);
+			offset += data[i].size();
+		}
+		for (int i = 0; i < frames; ++i)
+			f.write((const char *) data[i].data(), data[i].size());
+	}
+
+	if (!f) {
+		std::cerr << "ERROR cannot write " << out << std::endl;
+		return 3;
+	}
+	return 0;
+}
@@ -1,4 +1,5 @@
  #include <stdio.h>
+#include <stdlib.h>
 
 #define PICTURE_X 24
 #define PICTURE_Y 24
@@ -42,12 +43,26 @@ int pixel(int x, int y, int z) {
 	return 0; // OK draw
 }
 
-int main() {
+void put16(int v) {
+	putchar(v & 0xff);
+	putchar((v >> 8) & 0xff);
+}
+
+int main(int argc, char * argv[]) {
 	int x, y, z;
-	for (x = 0; x < PICTURE_X; ++x) {
-		for (y = 0; y < PICTURE_Y; ++y) {
-			for (z = 0; z < PICTURE_Z; ++z) {
-				int done = pixel(x, y, z);
+	int size = (argc > 1) ? atoi(argv[1]) : PICTURE_X; // Output cube side, drawing is scaled from PICTURE_X/Y/Z grid
+
+	/* Volume header: magic, version, dimensions */
+	fputs("AZPV", stdout);
+	put16(1);
+	put16(size);
+	put16(size);
+	put16(size);
+
+	for (x = 0; x < size; ++x) {
+		for (y = 0; y < size; ++y) {
+			for (z = 0; z < size; ++z) {
+				int done = pixel(x * PICTURE_X / size, y * PICTURE_Y / size, z * PICTURE_Z / size);
 				if (!done) {
 					putchar(0x00);
 					putchar(0x00);
@@ -0,0 +1,176 @@
+#include "sampler.h"
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/** Clamp a coordinate to a range
+  * @param [in] v  Coordinate
+  * @param [in] lo Lowest value
+  * @param [in] hi Highest value
+  * @return Clamped coordinate
+  */
+static inline float clamp(float v, float lo, float hi) {
+	if (v < lo) v = lo;
+	if (v > hi) v = hi;
+	return v;
+}
+
+void volume_column(const Volume & volume, float x, float y, int & ix, int & iy) {
+	ix = (clamp(x, -1, 1) + 1) * 0.5f * (volume.size_x - 1);
+	iy = (clamp(y, -1, 1) + 1) * 0.5f * (volume.size_y - 1);
+}
+
+int volume_layer(const Volume & volume, float z) {
+	return clamp(z, 0, 1) * (volume.size_z - 1);
+}
+
+/** Split a voxel coordinate into the two voxels around it
+  * @param [in]  f    Coordinate in voxels, in 0..size-1 range
+  * @param [in]  size Number of voxels along axis
+  * @param [out] i0   Voxel below coordinate
+  * @param [out] i1   Voxel above coordinate, i0 on last voxel
+  * @param [out] t    Weight of i1
+  */
+static inline void split(float f, int size, int & i0, int & i1, float & t) {
+	i0 = f;
+	i1 = (i0 < size - 1) ? i0 + 1 : i0;
+	t = f - i0;
+}
+
+/** Linear interpolation, in the same order of operations as the SSE2 path **/
+static inline float lerp(float a, float b, float t) {
+	return a + (b - a) * t;
+}
+
+/** Sample a volume at one position
+  * Same parameters as volume_sample(), for a single position
+  */
+static inline color sample_one(const Volume & volume, float x, float y, float z, int filter) {
+	float fx = (clamp(x, -1, 1) + 1) * 0.5f * (volume.size_x - 1);
+	float fy = (clamp(y, -1, 1) + 1) * 0.5f * (volume.size_y - 1);
+	float fz = clamp(z, 0, 1) * (volume.size_z - 1);
+
+	if (filter != SAMPLE_TRILINEAR)
+		return volume.at((int) fx, (int) fy, (int) fz);
+
+	int x0, x1, y0, y1, z0, z1;
+	float tx, ty, tz;
+	split(fx, volume.size_x, x0, x1, tx);
+	split(fy, volume.size_y, y0, y1, ty);
+	split(fz, volume.size_z, z0, z1, tz);
+
+	const color * corners[8] = {
+		&volume.at(x0, y0, z0), &volume.at(x1, y0, z0),
+		&volume.at(x0, y1, z0), &volume.at(x1, y1, z0),
+		&volume.at(x0, y0, z1), &volume.at(x1, y0, z1),
+		&volume.at(x0, y1, z1), &volume.at(x1, y1, z1),
+	};
+	uint8_t out[3];
+	for (int ch = 0; ch < 3; ++ch) {
+		float v[8];
+		for (int k = 0; k < 8; ++k)
+			v[k] = ((const uint8_t *) corners[k])[ch];
+		float c00 = lerp(v[0], v[1], tx);
+		float c10 = lerp(v[2], v[3], tx);
+		float c01 = lerp(v[4], v[5], tx);
+		float c11 = lerp(v[6], v[7], tx);
+		float c0 = lerp(c00, c10, ty);
+		float c1 = lerp(c01, c11, ty);
+		out[ch] = (int) (lerp(c0, c1, tz) + 0.5f);
+	}
+	return {out[0], out[1], out[2]};
+}
+
+void volume_sample_reference(const Volume & volume, const float * x, const float * y, const float * z, size_t count, color * colors, int filter) {
+	for (size_t i = 0; i < count; ++i)
+		colors[i] = sample_one(volume, x[i], y[i], z[i], filter);
+}
+
+#ifdef __SSE2__
+/** Multiply 32 bits integers, keeping low 32 bits of products like SSE4.1 _mm_mullo_epi32() **/
+static inline __m128i mullo(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(
+		_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))
+	);
+}
+
+/** Linear interpolation of 4 values at once **/
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 t) {
+	return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+/** Sample 4 positions at once, positions are computed in vectors and voxels are read one by one
+  * Same parameters as volume_sample(), for 4 positions
+  */
+static void sample_four(const Volume & volume, const float * x, const float * y, const float * z, color * colors, int filter) {
+	const __m128 one = _mm_set1_ps(1), half = _mm_set1_ps(0.5f);
+	__m128 fx = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(x), _mm_set1_ps(-1)), one);
+	__m128 fy = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(y), _mm_set1_ps(-1)), one);
+	__m128 fz = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(z), _mm_setzero_ps()), one);
+	fx = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(fx, one), half), _mm_set1_ps(volume.size_x - 1));
+	fy = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(fy, one), half), _mm_set1_ps(volume.size_y - 1));
+	fz = _mm_mul_ps(fz, _mm_set1_ps(volume.size_z - 1));
+
+	// Coordinates are positive, truncation is floor
+	__m128i x0 = _mm_cvttps_epi32(fx), y0 = _mm_cvttps_epi32(fy), z0 = _mm_cvttps_epi32(fz);
+	const __m128i stride_x = _mm_set1_epi32(volume.size_y * volume.size_z);
+	const __m128i stride_y = _mm_set1_epi32(volume.size_z);
+	__m128i base = _mm_add_epi32(mullo(_mm_add_epi32(mullo(x0, _mm_set1_epi32(volume.size_y)), y0), stride_y), z0);
+
+	alignas(16) uint32_t index[8][4];
+	_mm_store_si128((__m128i *) index[0], base);
+	if (filter != SAMPLE_TRILINEAR) {
+		for (int i = 0; i < 4; ++i)
+			colors[i] = volume.voxels[index[0][i]];
+		return;
+	}
+
+	// Offsets to the voxels above, 0 on last voxel of each axis
+	__m128i dx = _mm_and_si128(_mm_cmplt_epi32(x0, _mm_set1_epi32(volume.size_x - 1)), stride_x);
+	__m128i dy = _mm_and_si128(_mm_cmplt_epi32(y0, _mm_set1_epi32(volume.size_y - 1)), stride_y);
+	__m128i dz = _mm_and_si128(_mm_cmplt_epi32(z0, _mm_set1_epi32(volume.size_z - 1)), _mm_set1_epi32(1));
+	__m128i base_z = _mm_add_epi32(base, dz);
+	_mm_store_si128((__m128i *) index[1], _mm_add_epi32(base, dx));
+	_mm_store_si128((__m128i *) index[2], _mm_add_epi32(base, dy));
+	_mm_store_si128((__m128i *) index[3], _mm_add_epi32(_mm_add_epi32(base, dx), dy));
+	_mm_store_si128((__m128i *) index[4], base_z);
+	_mm_store_si128((__m128i *) index[5], _mm_add_epi32(base_z, dx));
+	_mm_store_si128((__m128i *) index[6], _mm_add_epi32(base_z, dy));
+	_mm_store_si128((__m128i *) index[7], _mm_add_epi32(_mm_add_epi32(base_z, dx), dy));
+
+	__m128 tx = _mm_sub_ps(fx, _mm_cvtepi32_ps(x0));
+	__m128 ty = _mm_sub_ps(fy, _mm_cvtepi32_ps(y0));
+	__m128 tz = _mm_sub_ps(fz, _mm_cvtepi32_ps(z0));
+
+	const uint8_t * voxels = (const uint8_t *) volume.voxels;
+	alignas(16) int32_t out[3][4];
+	for (int ch = 0; ch < 3; ++ch) {
+		__m128 v[8];
+		for (int k = 0; k < 8; ++k)
+			v[k] = _mm_setr_ps(
+				voxels[index[k][0] * 3 + ch], voxels[index[k][1] * 3 + ch],
+				voxels[index[k][2] * 3 + ch], voxels[index[k][3] * 3 + ch]
+			);
+		__m128 c0 = lerp4(lerp4(v[0], v[1], tx), lerp4(v[2], v[3], tx), ty);
+		__m128 c1 = lerp4(lerp4(v[4], v[5], tx), lerp4(v[6], v[7], tx), ty);
+		_mm_store_si128((__m128i *) out[ch], _mm_cvttps_epi32(_mm_add_ps(lerp4(c0, c1, tz), half)));
+	}
+	for (int i = 0; i < 4; ++i)
+		colors[i] = {(uint8_t) out[0][i], (uint8_t) out[1][i], (uint8_t) out[2][i]};
+}
+#endif
+
+void volume_sample(const Volume & volume, const float * x, const float * y, const float * z, size_t count, color * colors, int filter) {
+	size_t i = 0;
+#ifdef __SSE2__
+	// Voxel indices are computed on 32 bits
+	if ((uint64_t) volume.size_x * volume.size_y * volume.size_z <= UINT32_MAX)
+		for (; i + 4 <= count; i += 4)
+			sample_four(volume, x + i, y + i, z + i, colors + i, filter);
+#endif
+	volume_sample_reference(volume, x + i, y + i, z + i, count - i, colors + i, filter);
+}
@@ -0,0 +1,51 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <cstddef>
+#include "volume.h"
+
+/** Sampling filters
+  * Nearest picks the voxel below each coordinate, as truncation of
+  *   ix = (x + 1) / 2 * (size_x - 1)
+  *   iy = (y + 1) / 2 * (size_y - 1)
+  *   iz = z * (size_z - 1)
+  * Trilinear blends the 8 voxels around each coordinate, rounding to nearest.
+  */
+#define SAMPLE_NEAREST 0
+#define SAMPLE_TRILINEAR 1
+
+/** Give column of the voxel picked by nearest sampling
+  * @param [in]  volume Volume to sample, must not be empty
+  * @param [in]  x      X position, in -1..1 range
+  * @param [in]  y      Y position, in -1..1 range
+  * @param [out] ix     X index of column
+  * @param [out] iy     Y index of column
+  */
+void volume_column(const Volume & volume, float x, float y, int & ix, int & iy);
+
+/** Give layer of the voxel picked by nearest sampling
+  * @param [in] volume Volume to sample, must not be empty
+  * @param [in] z      Z position, in 0..1 range
+  * @return Z index of layer
+  */
+int volume_layer(const Volume & volume, float z);
+
+/** Sample a volume at many positions
+  * Positions are clamped to the volume. Uses SSE2 when the host has it, with
+  * the same result as volume_sample_reference() bit for bit.
+  * @param [in]  volume Volume to sample, must not be empty
+  * @param [in]  x      X of each position, in -1..1 range
+  * @param [in]  y      Y of each position, in -1..1 range
+  * @param [in]  z      Z of each position, in 0..1 range
+  * @param [in]  count  Number of positions
+  * @param [out] colors Color of each position
+  * @param [in]  filter SAMPLE_NEAREST or SAMPLE_TRILINEAR
+  */
+void volume_sample(const Volume & volume, const float * x, const float * y, const float * z, size_t count, color * colors, int filter);
+
+/** Sample a volume at many positions, one at a time without vector instructions
+  * Same parameters as volume_sample()
+  */
+void volume_sample_reference(const Volume & volume, const float * x, const float * y, const float * z, size_t count, color * colors, int filter);
+
+#endif // SAMPLER_H
@@ -0,0 +1,184 @@
+#include "sequence.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/** Read a little endian value
+  * @param [in] p     Bytes to read
+  * @param [in] bytes Size of value in bytes
+  * @return Value
+  */
+static uint64_t read_le(const unsigned char * p, int bytes) {
+	uint64_t v = 0;
+	for (int i = bytes - 1; i >= 0; --i)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+/** Read exactly some bytes at an offset of a file
+  * @param [in]  fd     File to read
+  * @param [out] data   Buffer to fill
+  * @param [in]  length Number of bytes to read
+  * @param [in]  offset Offset in file
+  * @return false on error or end of file
+  */
+static bool read_at(int fd, void * data, size_t length, uint64_t offset) {
+	while (length) {
+		ssize_t r = pread(fd, data, length, offset);
+		if (r <= 0)
+			return false;
+		data = (char *) data + r;
+		length -= r;
+		offset += r;
+	}
+	return true;
+}
+
+/** Read a frame into a volume buffer
+  * @param [in,out] sequence Sequence to read from
+  * @param [in]     frame    Number of frame to read
+  * @param [out]    volume   Buffer to fill, already sized
+  * @return false if frame cannot be read
+  */
+static bool read_frame(Sequence & sequence, unsigned frame, Volume & volume) {
+	const SequenceEntry & entry = sequence.index[frame];
+	bool ok = false;
+	if (entry.encoding == SEQUENCE_RAW) {
+		ok = entry.length == volume.storage.size() * sizeof(color) &&
+		     read_at(sequence.fd, volume.storage.data(), entry.length, entry.offset);
+	} else if (entry.encoding == SEQUENCE_RLE) {
+		sequence.encoded.resize(entry.length);
+		ok = read_at(sequence.fd, sequence.encoded.data(), entry.length, entry.offset) &&
+		     volume_decode_rle(sequence.encoded.data(), entry.length, volume.storage.data(), volume.storage.size());
+	}
+	if (ok)
+		volume_index(volume);
+	return ok;
+}
+
+/** Reader thread main loop
+  * @param [in,out] sequence Sequence to read ahead
+  */
+static void read_ahead(Sequence * sequence) {
+	std::unique_lock <std::mutex> lock(sequence->mutex);
+	while (true) {
+		sequence->wake.wait(lock, [sequence] { return sequence->stopping || sequence->pending; });
+		if (sequence->stopping)
+			return;
+
+		// Back buffer belongs to this thread until pending is cleared
+		unsigned frame = sequence->requested;
+		Volume & back = sequence->buffers[1 - sequence->front];
+		lock.unlock();
+		bool ok = read_frame(*sequence, frame, back);
+		lock.lock();
+
+		sequence->failed = !ok;
+		sequence->pending = false;
+		sequence->loaded.notify_all();
+	}
+}
+
+Sequence::~Sequence() {
+	sequence_close(*this);
+}
+
+bool sequence_open(Sequence & sequence, const char * filename) {
+	sequence_close(sequence);
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	unsigned char header[SEQUENCE_HEADER_SIZE];
+	if (!read_at(fd, header, SEQUENCE_HEADER_SIZE, 0) || memcmp(header, SEQUENCE_MAGIC, 4) ||
+	    read_le(header + 4, 2) != SEQUENCE_VERSION || !read_le(header + 12, 4)) {
+		close(fd);
+		return false;
+	}
+	sequence.fd = fd;
+	sequence.size_x = read_le(header + 6, 2);
+	sequence.size_y = read_le(header + 8, 2);
+	sequence.size_z = read_le(header + 10, 2);
+	sequence.frame_ms = read_le(header + 16, 2);
+
+	// Header fields are not trusted: index and frames must lie within the file
+	struct stat st;
+	unsigned frames = read_le(header + 12, 4);
+	if (fstat(fd, &st) < 0 || (uint64_t) frames * SEQUENCE_ENTRY_SIZE > (uint64_t) st.st_size - SEQUENCE_HEADER_SIZE) {
+		sequence_close(sequence);
+		return false;
+	}
+	uint64_t file_size = st.st_size;
+	std::vector <unsigned char> entries((size_t) frames * SEQUENCE_ENTRY_SIZE);
+	if (!read_at(fd, entries.data(), entries.size(), SEQUENCE_HEADER_SIZE)) {
+		sequence_close(sequence);
+		return false;
+	}
+	sequence.index.resize(frames);
+	for (unsigned i = 0; i < frames; ++i) {
+		const unsigned char * e = entries.data() + (size_t) i * SEQUENCE_ENTRY_SIZE;
+		SequenceEntry & entry = sequence.index[i];
+		entry.offset = read_le(e, 8);
+		entry.length = read_le(e + 8, 4);
+		entry.encoding = read_le(e + 12, 4);
+		if (entry.offset > file_size || entry.length > file_size - entry.offset) {
+			sequence_close(sequence);
+			return false;
+		}
+	}
+
+	// First frame is read now, next ones in background
+	for (Volume & buffer: sequence.buffers)
+		volume_fill(buffer, sequence.size_x, sequence.size_y, sequence.size_z, {0, 0, 0});
+	sequence.front = 0;
+	sequence.shown = 0;
+	if (!read_frame(sequence, 0, sequence.buffers[0])) {
+		sequence_close(sequence);
+		return false;
+	}
+	sequence.stopping = false;
+	sequence.failed = false;
+	sequence.requested = 1;
+	sequence.pending = frames > 1;
+	if (sequence.pending)
+		sequence.reader = std::thread(read_ahead, &sequence);
+	return true;
+}
+
+void sequence_close(Sequence & sequence) {
+	if (sequence.reader.joinable()) {
+		{
+			std::lock_guard <std::mutex> lock(sequence.mutex);
+			sequence.stopping = true;
+		}
+		sequence.wake.notify_all();
+		sequence.reader.join();
+	}
+	if (sequence.fd >= 0)
+		close(sequence.fd);
+	sequence.fd = -1;
+	sequence.index.clear();
+	for (Volume & buffer: sequence.buffers)
+		volume_release(buffer);
+}
+
+bool sequence_next(Sequence & sequence, bool wait) {
+	std::unique_lock <std::mutex> lock(sequence.mutex);
+	if (sequence.fd < 0 || sequence.index.size() < 2)
+		return false;
+	if (wait)
+		sequence.loaded.wait(lock, [&sequence] { return !sequence.pending; });
+	if (sequence.pending)
+		return false;
+
+	bool changed = !sequence.failed;
+	if (changed) {
+		sequence.front = 1 - sequence.front;
+		sequence.shown = sequence.requested;
+	}
+	sequence.requested = (sequence.shown + 1) % sequence.index.size();
+	sequence.pending = true;
+	sequence.wake.notify_all();
+	return changed;
+}
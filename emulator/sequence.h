@@ -0,0 +1,99 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "volume.h"
+
+/** Sequence file layout
+  * A sequence file starts with a 20 bytes header, all fields little endian:
+  *   char magic[4]    "AZPA"
+  *   uint16 version   SEQUENCE_VERSION
+  *   uint16 size_x    Number of voxels along X
+  *   uint16 size_y    Number of voxels along Y
+  *   uint16 size_z    Number of voxels along Z
+  *   uint32 frames    Number of frames
+  *   uint16 frame_ms  Duration of each frame in milliseconds
+  *   uint16 reserved  0
+  * followed by an index of 16 bytes per frame:
+  *   uint64 offset    Offset of frame data from start of file
+  *   uint32 length    Length of frame data
+  *   uint32 encoding  SEQUENCE_RAW or SEQUENCE_RLE
+  * Raw frame data is laid out as volume voxels, run-length encoded frame data
+  * as voxels of run-length encoded volumes.
+  */
+#define SEQUENCE_MAGIC "AZPA"
+#define SEQUENCE_VERSION 1
+#define SEQUENCE_HEADER_SIZE 20
+#define SEQUENCE_ENTRY_SIZE 16
+#define SEQUENCE_RAW 0
+#define SEQUENCE_RLE 1
+
+/** Position of a frame in a sequence file **/
+struct SequenceEntry {
+	uint64_t offset; // Offset of frame data from start of file
+	uint32_t length; // Length of frame data
+	uint32_t encoding; // How frame data is encoded
+};
+
+/** Sequence of volumes played from a file
+  * Only two frames are in memory: the one shown, and the next one read ahead by a background thread.
+  */
+struct Sequence {
+	int fd = -1; // Sequence file
+	int size_x = 0; // Number of voxels along X
+	int size_y = 0; // Number of voxels along Y
+	int size_z = 0; // Number of voxels along Z
+	unsigned frame_ms = 0; // Duration of each frame in milliseconds
+	std::vector <SequenceEntry> index; // Position of each frame in file
+
+	Volume buffers[2]; // Frame shown and frame read ahead
+	std::vector <unsigned char> encoded; // Encoded frame data being read by reader thread
+	int front = 0; // Buffer of frame shown
+	unsigned shown = 0; // Number of frame shown
+
+	// Read-ahead, shared with reader thread
+	std::thread reader;
+	std::mutex mutex;
+	std::condition_variable wake; // Signaled when a frame is requested or sequence is closed
+	std::condition_variable loaded; // Signaled when requested frame is read
+	unsigned requested = 0; // Number of frame to read in back buffer
+	bool pending = false; // Is requested frame still to be read
+	bool failed = false; // Did reading requested frame fail
+	bool stopping = false;
+
+	Sequence() = default;
+	Sequence(const Sequence &) = delete;
+	Sequence & operator=(const Sequence &) = delete;
+	~Sequence();
+};
+
+/** Open a sequence file, read its first frame and start reading ahead the next one
+  * @param [out] sequence Sequence to open
+  * @param [in]  filename Name of file to read
+  * @return false if file cannot be read or is not a sequence
+  */
+bool sequence_open(Sequence & sequence, const char * filename);
+
+/** Stop reading ahead and close sequence file
+  * @param [in,out] sequence Sequence to close
+  */
+void sequence_close(Sequence & sequence);
+
+/** Show next frame if it has been read ahead, and start reading the following one
+  * @param [in,out] sequence Sequence to advance
+  * @param [in]     wait     Wait for next frame instead of keeping current one if it is not read yet
+  * @return true if shown frame changed
+  */
+bool sequence_next(Sequence & sequence, bool wait);
+
+/** Give frame shown
+  * @param [in] sequence Opened sequence
+  * @return Volume of frame shown
+  */
+inline const Volume & sequence_frame(const Sequence & sequence) { return sequence.buffers[sequence.front]; }
+
+#endif // SEQUENCE_H
@@ -0,0 +1,338 @@
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <getopt.h>
+#include "volume.h"
+#include "sampler.h"
+#include "geometry.h"
+#include "slices.h"
+
+/** Write a little endian value
+  * @param [out] f     Stream to write to
+  * @param [in]  v     Value
+  * @param [in]  bytes Size of value in bytes
+  */
+void write_le(std::ostream & f, uint64_t v, int bytes) {
+	for (int i = 0; i < bytes; ++i)
+		f.put((v >> (8 * i)) & 0xff);
+}
+
+/** Build a palette of at most max colors, with black as first entry
+  * When there are too many colors, low bits of channels are dropped until
+  * they fit, and each palette entry is the average of the colors it replaces.
+  * @param [in]  table   Colors to fit in palette
+  * @param [in]  max     Largest number of palette entries
+  * @param [out] palette Palette entries
+  * @param [out] entries Palette entry of each color of table
+  */
+void build_palette(const std::vector <color> & table, size_t max, std::vector <color> & palette, std::vector <uint8_t> & entries) {
+	auto key = [] (color c, int shift) -> uint32_t {
+		return (uint32_t) (c.r >> shift) << 16 | (c.g >> shift) << 8 | (c.b >> shift);
+	};
+
+	struct Sum {
+		uint64_t r = 0, g = 0, b = 0, n = 0;
+	};
+	std::map <uint32_t, Sum> buckets;
+	int shift = 0;
+	for (;; ++shift) {
+		buckets.clear();
+		for (const color & c: table) {
+			if (!(c.r || c.g || c.b))
+				continue;
+			Sum & sum = buckets[key(c, shift)];
+			sum.r += c.r;
+			sum.g += c.g;
+			sum.b += c.b;
+			++sum.n;
+			if (buckets.size() > max - 1)
+				break;
+		}
+		if (buckets.size() <= max - 1)
+			break;
+	}
+
+	std::unordered_map <uint32_t, uint8_t> index;
+	palette.assign(1, {0, 0, 0});
+	for (auto & bucket: buckets) {
+		Sum & sum = bucket.second;
+		color c = {
+			(uint8_t) ((sum.r + sum.n / 2) / sum.n),
+			(uint8_t) ((sum.g + sum.n / 2) / sum.n),
+			(uint8_t) ((sum.b + sum.n / 2) / sum.n)
+		};
+		// Lit pixels must stay lit
+		if (!(c.r || c.g || c.b)) {
+			if (sum.r >= sum.g && sum.r >= sum.b) c.r = 1;
+			else if (sum.g >= sum.b) c.g = 1;
+			else c.b = 1;
+		}
+		index[bucket.first] = palette.size();
+		palette.push_back(c);
+	}
+
+	entries.resize(table.size());
+	for (size_t i = 0; i < table.size(); ++i) {
+		const color & c = table[i];
+		entries[i] = (c.r || c.g || c.b) ? index[key(c, shift)] : 0;
+	}
+}
+
+/** Code a step as changes from previous one, as described in slices.h
+  * @param [in]  step     Step to code
+  * @param [in]  previous Previous step, or all 0 for a keyframe
+  * @param [in]  length   Number of bytes of a step
+  * @param [out] code     Coded step, appended
+  */
+void encode_delta(const uint8_t * step, const uint8_t * previous, size_t length, std::vector <uint8_t> & code) {
+	size_t i = 0;
+	while (i < length) {
+		// Unchanged bytes
+		size_t n = 0;
+		while (i + n < length && n < 128 && step[i + n] == previous[i + n])
+			++n;
+		if (n) {
+			code.push_back(n - 1);
+			i += n;
+			continue;
+		}
+
+		// Changed bytes, a single unchanged byte costs the same in them as after them
+		n = 0;
+		while (i + n < length && n < 128 &&
+		       (step[i + n] != previous[i + n] ||
+		        (i + n + 1 < length && step[i + n + 1] != previous[i + n + 1])))
+			++n;
+		code.push_back(0x7f + n);
+		code.insert(code.end(), step + i, step + i + n);
+		i += n;
+	}
+}
+
+/** Print usage message **/
+void usage() {
+	std::cout << "Compiles an AziPOV volume into the colors of each led at each angle step" << std::endl
+	          << "    --out|-o <f>    slice table to create" << std::endl
+	          << "    --pic|-p <p>    volume to compile" << std::endl
+	          << "    --smooth        blend volume voxels around leds instead of taking nearest one" << std::endl
+	          << "    --format <f>    pixel format: rgb, pal8 (256 colors) or pal4 (16 colors)" << std::endl
+	          << "    --keyframe <n>  code steps as changes from previous one, with a keyframe every" << std::endl
+	          << "                    n steps (default 0, steps are stored as is)" << std::endl
+	          << std::endl
+	          << "    --turns <t>     number of turns covered by the table" << std::endl
+	          << "    --da <da>       angular resolution in degrees" << std::endl
+	          << "    --a <a>         size of inner wheel" << std::endl
+	          << "    --b <b>         size of outer wheel" << std::endl
+	          << "    --dh <dh>       vertical resolution" << std::endl
+	          << "    --h <h>         length of led bars" << std::endl
+	          << "    --nr <nr>       number of wheels" << std::endl
+	          << "    --led|-l <led>  add a led, with the same syntax as the emulator" << std::endl
+	          << std::endl
+	          << "Geometry defaults and sampling are the same as the emulator's, so that" << std::endl
+	          << "the table holds the colors of its trace." << std::endl
+	          << std::endl
+	          << "Sample command line: -o star.azps -p pictures/star.raw --turns 20 --da 0.5 --nr 5" << std::endl
+	          << "                     -o star.azps -p pictures/star.raw --format pal4 --keyframe 64" << std::endl;
+}
+
+/** Main function used as entry point **/
+int main(int argc, char * argv[]) {
+	const char * out = nullptr;
+	const char * picturename = nullptr;
+	int filter = SAMPLE_NEAREST;
+	int format = SLICES_RGB;
+	unsigned keyframe = 0;
+	int turns = 5;
+	int nr = 2;
+	float da = 2;
+	float a = 2;
+	float b = 2.5;
+	float dh = 0.7;
+	float h = 11.2;
+	std::vector <Led> leds;
+
+	int c;
+	int option_index = 0;
+	struct option options[] = {
+		{"out", required_argument, 0, 'o'},
+		{"pic", required_argument, 0, 'p'},
+		{"smooth", no_argument, 0, 0x01},
+		{"help", no_argument, 0, 0x02},
+		{"turns", required_argument, 0, 0x03},
+		{"da", required_argument, 0, 0x04},
+		{"a", required_argument, 0, 'a'},
+		{"b", required_argument, 0, 'b'},
+		{"dh", required_argument, 0, 0x05},
+		{"h", required_argument, 0, 'h'},
+		{"nr", required_argument, 0, 'n'},
+		{"led", required_argument, 0, 'l'},
+		{"format", required_argument, 0, 0x06},
+		{"keyframe", required_argument, 0, 0x07},
+		{0, 0, 0, 0}
+	};
+	while((c = getopt_long(argc, argv, "o:p:a:b:h:l:", options, &option_index)) != -1) {
+		if (c == 'o') {
+			out = optarg;
+		} else if (c == 'p') {
+			picturename = optarg;
+		} else if (c == 0x01) {
+			filter = SAMPLE_TRILINEAR;
+		} else if (c == 0x02) {
+			usage();
+			return 2;
+		} else if (c == 0x03) {
+			turns = strtoul(optarg, NULL, 10);
+		} else if (c == 0x04) {
+			da = strtof(optarg, NULL);
+		} else if (c == 'a') {
+			a = strtof(optarg, NULL);
+		} else if (c == 'b') {
+			b = strtof(optarg, NULL);
+		} else if (c == 0x05) {
+			dh = strtof(optarg, NULL);
+		} else if (c == 'h') {
+			h = strtof(optarg, NULL);
+		} else if (c == 'n') {
+			nr = strtoul(optarg, NULL, 10);
+		} else if (c == 'l') {
+			Led l;
+			led_parse(optarg, b, l);
+			leds.push_back(l);
+		} else if (c == 0x06) {
+			if (!strcmp(optarg, "rgb")) {
+				format = SLICES_RGB;
+			} else if (!strcmp(optarg, "pal8")) {
+				format = SLICES_PAL8;
+			} else if (!strcmp(optarg, "pal4")) {
+				format = SLICES_PAL4;
+			} else {
+				usage();
+				return 1;
+			}
+		} else if (c == 0x07) {
+			keyframe = strtoul(optarg, NULL, 10);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!out || !picturename || optind != argc || da <= 0 || nr <= 0 || keyframe > UINT16_MAX) {
+		usage();
+		return 1;
+	}
+	if (leds.size() == 0)
+		leds_default(nr, a, b, leds);
+
+	Volume volume;
+	if (!volume_load(volume, picturename)) {
+		std::cerr << "ERROR cannot read volume " << picturename << std::endl;
+		return 3;
+	}
+
+	std::vector <float> heights, z;
+	bar_heights(dh, h, heights, z);
+	uint32_t steps = ceil(turns * 360 / da);
+	size_t pixels = heights.size();
+	if (leds.size() > UINT16_MAX || pixels > UINT16_MAX) {
+		std::cerr << "ERROR too many leds or pixels per led" << std::endl;
+		return 1;
+	}
+
+	// Sample one angle step at a time, all bars in a single batch
+	size_t samples = leds.size() * pixels;
+	float radius = trajectory_radius(a, b, leds);
+	std::vector <float> xs(samples), ys(samples), zs(samples);
+	std::vector <color> table((size_t) steps * samples);
+	std::vector <float> nxs((size_t) leds.size() * steps), nys((size_t) leds.size() * steps);
+	for (size_t l = 0; l < leds.size(); ++l) {
+		std::copy(z.begin(), z.end(), zs.begin() + l * pixels);
+		led_trajectory(a, b, leds[l], radius, wheel_angle(0, da, leds[l].wheel_nr, nr), da, steps,
+		               &nxs[l * steps], &nys[l * steps]);
+	}
+	for (uint32_t s = 0; s < steps; ++s) {
+		for (size_t l = 0; l < leds.size(); ++l) {
+			std::fill(xs.begin() + l * pixels, xs.begin() + (l + 1) * pixels, nxs[l * steps + s]);
+			std::fill(ys.begin() + l * pixels, ys.begin() + (l + 1) * pixels, nys[l * steps + s]);
+		}
+		volume_sample(volume, xs.data(), ys.data(), zs.data(), samples, &table[(size_t) s * samples], filter);
+	}
+
+	// Convert to pixel format
+	std::vector <color> palette;
+	std::vector <uint8_t> entries;
+	size_t bar_bytes = pixels * 3;
+	if (format == SLICES_PAL8) {
+		build_palette(table, 256, palette, entries);
+		bar_bytes = pixels;
+	} else if (format == SLICES_PAL4) {
+		build_palette(table, 16, palette, entries);
+		bar_bytes = (pixels + 1) / 2;
+	}
+	size_t step_bytes = leds.size() * bar_bytes;
+	std::vector <uint8_t> pixels_data((size_t) steps * step_bytes, 0);
+	for (size_t i = 0; i < table.size(); ++i) {
+		size_t bar = i / pixels, p = i % pixels;
+		uint8_t * out_bar = &pixels_data[bar * bar_bytes];
+		if (format == SLICES_RGB)
+			memcpy(out_bar + p * 3, &table[i], 3);
+		else if (format == SLICES_PAL8)
+			out_bar[p] = entries[i];
+		else
+			out_bar[p / 2] |= entries[i] << (4 * (p % 2));
+	}
+
+	// Code steps as changes
+	std::vector <uint32_t> keyframes;
+	std::vector <uint8_t> code;
+	if (keyframe) {
+		std::vector <uint8_t> black(step_bytes, 0);
+		for (uint32_t s = 0; s < steps; ++s) {
+			const uint8_t * step = &pixels_data[(size_t) s * step_bytes];
+			if (s % keyframe == 0) {
+				keyframes.push_back(code.size());
+				encode_delta(step, black.data(), step_bytes, code);
+			} else {
+				encode_delta(step, step - step_bytes, step_bytes, code);
+			}
+		}
+	} else {
+		code.swap(pixels_data);
+	}
+
+	std::ofstream f(out, std::ios::binary);
+	f.write(SLICES_MAGIC, 4);
+	write_le(f, SLICES_VERSION, 2);
+	write_le(f, leds.size(), 2);
+	write_le(f, pixels, 2);
+	write_le(f, nr, 2);
+	write_le(f, steps, 4);
+	write_le(f, lround(da * 1e6), 4);
+	write_le(f, turns, 4);
+	write_le(f, format, 2);
+	write_le(f, palette.size(), 2);
+	write_le(f, keyframe, 2);
+	write_le(f, 0, 2);
+	for (Led & led: leds) {
+		write_le(f, led.wheel_nr, 2);
+		write_le(f, 0, 2);
+	}
+	f.write((const char *) palette.data(), palette.size() * sizeof(color));
+	for (size_t i = palette.size() * sizeof(color); i % 4; ++i)
+		f.put(0);
+	for (uint32_t offset: keyframes)
+		write_le(f, offset, 4);
+	f.write((const char *) code.data(), code.size());
+
+	if (!f) {
+		std::cerr << "ERROR cannot write " << out << std::endl;
+		return 3;
+	}
+	std::cout << steps << " steps of " << leds.size() << " leds of " << pixels << " pixels, "
+	          << f.tellp() << " bytes" << std::endl;
+	return 0;
+}
@@ -0,0 +1,284 @@
+#include "softrender.h"
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <climits>
+
+/** Multiply two column-major 4x4 matrices
+  * @param [out] r Result, a * b
+  * @param [in]  a Left matrix
+  * @param [in]  b Right matrix
+  */
+static void mat_mul(double r[16], const double a[16], const double b[16]) {
+	double t[16];
+	for (int c = 0; c < 4; ++c)
+		for (int l = 0; l < 4; ++l)
+			t[c * 4 + l] = a[l] * b[c * 4] + a[4 + l] * b[c * 4 + 1] + a[8 + l] * b[c * 4 + 2] + a[12 + l] * b[c * 4 + 3];
+	std::copy(t, t + 16, r);
+}
+
+/** Build a rotation matrix like glRotated
+  * @param [out] m     Rotation matrix
+  * @param [in]  angle Angle in degrees
+  * @param [in]  x     X coordinate of normalized axis
+  * @param [in]  y     Y coordinate of normalized axis
+  * @param [in]  z     Z coordinate of normalized axis
+  */
+static void mat_rotate(double m[16], double angle, double x, double y, double z) {
+	double c = cos(angle * M_PI / 180), s = sin(angle * M_PI / 180);
+	double r[16] = {
+		x*x*(1-c) + c,   y*x*(1-c) + z*s, x*z*(1-c) - y*s, 0,
+		x*y*(1-c) - z*s, y*y*(1-c) + c,   y*z*(1-c) + x*s, 0,
+		x*z*(1-c) + y*s, y*z*(1-c) - x*s, z*z*(1-c) + c,   0,
+		0,               0,               0,               1
+	};
+	std::copy(r, r + 16, m);
+}
+
+/** Invert a 4x4 matrix
+  * @param [out] r Inverse matrix
+  * @param [in]  m Matrix to invert
+  * @return false if matrix is singular
+  */
+static bool mat_invert(double r[16], const double m[16]) {
+	double inv[16];
+	inv[0] = m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+	inv[4] = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+	inv[8] = m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+	inv[12] = -m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+	inv[1] = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+	inv[5] = m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+	inv[9] = -m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+	inv[13] = m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+	inv[2] = m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+	inv[6] = -m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+	inv[10] = m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+	inv[14] = -m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+	inv[3] = -m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+	inv[7] = m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+	inv[11] = -m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11] - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+	inv[15] = m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10] + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+
+	double det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+	if (det == 0)
+		return false;
+	for (int i = 0; i < 16; ++i)
+		r[i] = inv[i] / det;
+	return true;
+}
+
+/** Transform a point by a matrix
+  * @param [out] r Transformed homogeneous point
+  * @param [in]  m Matrix
+  * @param [in]  p Homogeneous point to transform
+  */
+static void mat_apply(double r[4], const double m[16], const double p[4]) {
+	for (int l = 0; l < 4; ++l)
+		r[l] = m[l] * p[0] + m[4 + l] * p[1] + m[8 + l] * p[2] + m[12 + l] * p[3];
+}
+
+/** Write a pixel if it passes depth test
+  * @param [in,out] fb    Framebuffer to draw in
+  * @param [in]     x     Pixel column
+  * @param [in]     y     Pixel row, from bottom
+  * @param [in]     depth Window depth
+  * @param [in]     color Color to write
+  */
+static inline void plot(Framebuffer & fb, int x, int y, float depth, const uint8_t color[3]) {
+	if (x < 0 || x >= fb.width || y < 0 || y >= fb.height)
+		return;
+	size_t i = (size_t) y * fb.width + x;
+	if (depth > fb.depth[i])
+		return;
+	fb.depth[i] = depth;
+	fb.pixels[i * 3] = color[0];
+	fb.pixels[i * 3 + 1] = color[1];
+	fb.pixels[i * 3 + 2] = color[2];
+}
+
+/** Run a loop body over a range, with framebuffer threads if any
+  * @param [in] fb    Framebuffer giving threads
+  * @param [in] count Size of the range
+  * @param [in] chunk Maximum number of iterations given to a thread at once
+  * @param [in] body  Function called with begin and end of each chunk
+  */
+static void parallel_for(Framebuffer & fb, size_t count, size_t chunk, const std::function <void(size_t, size_t)> & body) {
+	if (fb.pool)
+		fb.pool->parallel_for(count, chunk, body);
+	else
+		body(0, count);
+}
+
+void soft_init(Framebuffer & fb, int width, int height) {
+	fb.width = width;
+	fb.height = height;
+	fb.pixels.resize((size_t) width * height * 3);
+	fb.depth.resize((size_t) width * height);
+	soft_camera(fb, 20, 90, 0);
+	soft_clear(fb);
+}
+
+void soft_clear(Framebuffer & fb) {
+	std::fill(fb.pixels.begin(), fb.pixels.end(), 0);
+	std::fill(fb.depth.begin(), fb.depth.end(), 1.0f);
+}
+
+void soft_camera(Framebuffer & fb, float distance, float angle_y, float angle_z) {
+	// Same as gluPerspective(70, width / height, 1, 1000)
+	const double near = 1, far = 1000;
+	double f = 1 / tan(70 * M_PI / 360);
+	double aspect = (double) fb.width / fb.height;
+	double projection[16] = {
+		f / aspect, 0, 0, 0,
+		0, f, 0, 0,
+		0, 0, (far + near) / (near - far), -1,
+		0, 0, 2 * far * near / (near - far), 0
+	};
+
+	// Same as gluLookAt(distance, 0, 0, 0, 0, 0, 0, 0, 1)
+	double view[16] = {
+		0, 0, 1, 0,
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, -distance, 1
+	};
+
+	double rotation[16];
+	mat_mul(fb.matrix, projection, view);
+	mat_rotate(rotation, angle_y, 0, 1, 0);
+	mat_mul(fb.matrix, fb.matrix, rotation);
+	mat_rotate(rotation, angle_z, 0, 0, 1);
+	mat_mul(fb.matrix, fb.matrix, rotation);
+	mat_invert(fb.inverse, fb.matrix);
+}
+
+void soft_ground(Framebuffer & fb, float size, const uint8_t from[3], const uint8_t to[3]) {
+	parallel_for(fb, fb.height, 16, [&] (size_t begin, size_t end) {
+		for (int y = begin; y < (int) end; ++y) {
+			for (int x = 0; x < fb.width; ++x) {
+				// Cast a ray from near to far plane through pixel center
+				double ndc_x = (x + 0.5) * 2 / fb.width - 1;
+				double ndc_y = (y + 0.5) * 2 / fb.height - 1;
+				double near[4] = {ndc_x, ndc_y, -1, 1}, far[4] = {ndc_x, ndc_y, 1, 1};
+				double p0[4], p1[4];
+				mat_apply(p0, fb.inverse, near);
+				mat_apply(p1, fb.inverse, far);
+				for (int i = 0; i < 3; ++i) {
+					p0[i] /= p0[3];
+					p1[i] /= p1[3];
+				}
+
+				// Intersect it with ground plane
+				if (p0[2] == p1[2])
+					continue;
+				double t = -p0[2] / (p1[2] - p0[2]);
+				if (t < 0 || t > 1)
+					continue;
+				double hit[4] = {p0[0] + t * (p1[0] - p0[0]), p0[1] + t * (p1[1] - p0[1]), 0, 1};
+				if (fabs(hit[0]) > size || fabs(hit[1]) > size)
+					continue;
+
+				double clip[4];
+				mat_apply(clip, fb.matrix, hit);
+				double k = (hit[0] + size) / (2 * size);
+				uint8_t color[3];
+				for (int i = 0; i < 3; ++i)
+					color[i] = lround(from[i] + k * (to[i] - from[i]));
+				plot(fb, x, y, (clip[2] / clip[3] + 1) / 2, color);
+			}
+		}
+	});
+}
+
+/** Draw a single line segment, clipped by near plane
+  * @param [in,out] fb    Framebuffer to draw in
+  * @param [in]     a     First vertex
+  * @param [in]     b     Second vertex
+  * @param [in]     color Color of line
+  */
+static void soft_segment(Framebuffer & fb, const float * a, const float * b, const uint8_t color[3]) {
+	double pa[4] = {a[0], a[1], a[2], 1}, pb[4] = {b[0], b[1], b[2], 1};
+	double ca[4], cb[4];
+	mat_apply(ca, fb.matrix, pa);
+	mat_apply(cb, fb.matrix, pb);
+
+	// Near plane clipping
+	double da = ca[2] + ca[3], db = cb[2] + cb[3];
+	if (da < 0 && db < 0)
+		return;
+	if (da < 0 || db < 0) {
+		double t = da / (da - db);
+		double * out = (da < 0) ? ca : cb;
+		for (int i = 0; i < 4; ++i)
+			out[i] = ca[i] + t * (cb[i] - ca[i]);
+	}
+
+	double xa = (ca[0] / ca[3] + 1) / 2 * fb.width, ya = (ca[1] / ca[3] + 1) / 2 * fb.height, za = (ca[2] / ca[3] + 1) / 2;
+	double xb = (cb[0] / cb[3] + 1) / 2 * fb.width, yb = (cb[1] / cb[3] + 1) / 2 * fb.height, zb = (cb[2] / cb[3] + 1) / 2;
+	int steps = std::max(fabs(xb - xa), fabs(yb - ya));
+	for (int i = 0; i <= steps; ++i) {
+		double t = steps ? (double) i / steps : 0;
+		plot(fb, floor(xa + t * (xb - xa)), floor(ya + t * (yb - ya)), za + t * (zb - za), color);
+	}
+}
+
+void soft_lines(Framebuffer & fb, const float * vertices, size_t count, const uint8_t color[3], bool loop) {
+	if (loop) {
+		for (size_t i = 0; i < count; ++i)
+			soft_segment(fb, vertices + i * 3, vertices + ((i + 1) % count) * 3, color);
+	} else {
+		for (size_t i = 0; i + 1 < count; i += 2)
+			soft_segment(fb, vertices + i * 3, vertices + (i + 1) * 3, color);
+	}
+}
+
+void soft_points(Framebuffer & fb, const float * vertices, const uint8_t * colors, size_t count, int size) {
+	fb.point_x.resize(count);
+	fb.point_y.resize(count);
+	fb.point_z.resize(count);
+
+	// Project batches of points
+	parallel_for(fb, count, 4096, [&] (size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			double p[4] = {vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], 1};
+			double c[4];
+			mat_apply(c, fb.matrix, p);
+
+			// Points whose center is out of view volume are discarded, as OpenGL does
+			if (c[3] <= 0 || fabs(c[0]) > c[3] || fabs(c[1]) > c[3] || fabs(c[2]) > c[3]) {
+				fb.point_x[i] = INT_MIN;
+				continue;
+			}
+
+			double x = (c[0] / c[3] + 1) / 2 * fb.width;
+			double y = (c[1] / c[3] + 1) / 2 * fb.height;
+			fb.point_x[i] = ceil(x - size / 2.0 - 0.5);
+			fb.point_y[i] = ceil(y - size / 2.0 - 0.5);
+			fb.point_z[i] = (c[2] / c[3] + 1) / 2;
+		}
+	});
+
+	// Splat them band by band, each band keeping drawing order so that result is deterministic
+	const int band = 16;
+	parallel_for(fb, (fb.height + band - 1) / band, 1, [&] (size_t begin, size_t end) {
+		int y_min = begin * band, y_max = std::min<int>(end * band, fb.height);
+		for (size_t i = 0; i < count; ++i) {
+			int x0 = fb.point_x[i], y0 = fb.point_y[i];
+			if (x0 == INT_MIN || y0 + size <= y_min || y0 >= y_max)
+				continue;
+			for (int y = std::max(y0, y_min); y < std::min(y0 + size, y_max); ++y)
+				for (int x = x0; x < x0 + size; ++x)
+					plot(fb, x, y, fb.point_z[i], colors + i * 3);
+		}
+	});
+}
+
+bool soft_write_ppm(const Framebuffer & fb, const char * filename) {
+	FILE * f = fopen(filename, "wb");
+	if (!f)
+		return false;
+	fprintf(f, "P6\n%d %d\n255\n", fb.width, fb.height);
+	for (int y = fb.height - 1; y >= 0; --y)
+		fwrite(fb.pixels.data() + (size_t) y * fb.width * 3, 3, fb.width, f);
+	return fclose(f) == 0;
+}
@@ -0,0 +1,80 @@
+#ifndef SOFTRENDER_H
+#define SOFTRENDER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "threadpool.h"
+
+/** Target of the software renderer
+  * Output only depends on what is drawn and in which order, not on the number of threads
+  */
+struct Framebuffer {
+	int width = 0;
+	int height = 0;
+	double matrix[16]; // World to clip space transform, column-major like OpenGL
+	double inverse[16]; // Clip to world space transform
+	std::vector <uint8_t> pixels; // RGB of each pixel, bottom row first like OpenGL
+	std::vector <float> depth; // Window depth of each pixel
+	ThreadPool * pool = nullptr; // Threads to render with, nullptr to render in calling thread
+
+	// Points projected by soft_points()
+	std::vector <int> point_x; // Left column of each point, or INT_MIN if clipped
+	std::vector <int> point_y; // Bottom row of each point
+	std::vector <float> point_z; // Window depth of each point
+};
+
+/** Allocate framebuffer and clear it
+  * @param [out] fb     Framebuffer to initialize
+  * @param [in]  width  Width in pixels
+  * @param [in]  height Height in pixels
+  */
+void soft_init(Framebuffer & fb, int width, int height);
+
+/** Clear colors to black and depth to far plane
+  * @param [in,out] fb Framebuffer to clear
+  */
+void soft_clear(Framebuffer & fb);
+
+/** Set camera, with the same projection as the OpenGL window
+  * @param [in,out] fb       Framebuffer to set camera of
+  * @param [in]     distance Distance of the eye to the origin
+  * @param [in]     angle_y  Rotation of the scene around Y axis in degrees
+  * @param [in]     angle_z  Rotation of the scene around Z axis in degrees
+  */
+void soft_camera(Framebuffer & fb, float distance, float angle_y, float angle_z);
+
+/** Draw a square ground centered on origin in z = 0 plane, shaded along X
+  * @param [in,out] fb   Framebuffer to draw in
+  * @param [in]     size Half length of square side
+  * @param [in]     from Color at -size on X axis
+  * @param [in]     to   Color at +size on X axis
+  */
+void soft_ground(Framebuffer & fb, float size, const uint8_t from[3], const uint8_t to[3]);
+
+/** Draw lines of one pixel width
+  * @param [in,out] fb       Framebuffer to draw in
+  * @param [in]     vertices X, Y, Z of each vertex
+  * @param [in]     count    Number of vertices
+  * @param [in]     color    Color of lines
+  * @param [in]     loop     true to join consecutive vertices in a loop like GL_LINE_LOOP, false to join them by pairs like GL_LINES
+  */
+void soft_lines(Framebuffer & fb, const float * vertices, size_t count, const uint8_t color[3], bool loop);
+
+/** Draw square points
+  * @param [in,out] fb       Framebuffer to draw in
+  * @param [in]     vertices X, Y, Z of each point
+  * @param [in]     colors   R, G, B of each point
+  * @param [in]     count    Number of points
+  * @param [in]     size     Side of points in pixels
+  */
+void soft_points(Framebuffer & fb, const float * vertices, const uint8_t * colors, size_t count, int size);
+
+/** Write framebuffer colors to a binary PPM file
+  * @param [in] fb       Framebuffer to write
+  * @param [in] filename Name of file to create
+  * @return true on success
+  */
+bool soft_write_ppm(const Framebuffer & fb, const char * filename);
+
+#endif // SOFTRENDER_H
@@ -0,0 +1,180 @@
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <getopt.h>
+#include "volume.h"
+#include "sequence.h"
+#include "slices.h"
+#include "store.h"
+
+/** Append a little endian value
+  * @param [out] data  Bytes to append to
+  * @param [in]  v     Value
+  * @param [in]  bytes Size of value in bytes
+  */
+void append_le(std::vector <uint8_t> & data, uint64_t v, int bytes) {
+	for (int i = 0; i < bytes; ++i)
+		data.push_back((v >> (8 * i)) & 0xff);
+}
+
+/** Give type of a content from its magic
+  * @param [in] data Content
+  * @return STORE_SLICES, STORE_VOLUME, STORE_SEQUENCE or STORE_RAW
+  */
+uint16_t content_type(const std::vector <uint8_t> & data) {
+	if (data.size() < 4)
+		return STORE_RAW;
+	const char * magic = (const char *) data.data();
+	if (!memcmp(magic, SLICES_MAGIC, 4))
+		return STORE_SLICES;
+	if (!memcmp(magic, VOLUME_MAGIC, 4) || !memcmp(magic, VOLUME_RLE_MAGIC, 4))
+		return STORE_VOLUME;
+	if (!memcmp(magic, SEQUENCE_MAGIC, 4))
+		return STORE_SEQUENCE;
+	return STORE_RAW;
+}
+
+/** Print directory of a content store
+  * @param [in] name File of content store
+  * @return 0 on success, 3 if store cannot be read or is not valid
+  */
+int list(const char * name) {
+	std::ifstream f(name, std::ios::binary);
+	std::vector <uint8_t> data((std::istreambuf_iterator <char> (f)), std::istreambuf_iterator <char> ());
+	const struct store_header * header = (const struct store_header *) data.data();
+	if (!f.is_open() || !store_check(header, data.size(), 1)) {
+		std::cerr << "ERROR " << name << " is not a valid content store" << std::endl;
+		return 3;
+	}
+	static const char * types[] = {"raw", "slices", "volume", "sequence"};
+	const struct store_entry * entries = store_entries(header);
+	for (uint16_t i = 0; i < header->entries; ++i) {
+		std::cout << i << "\t" << entries[i].name << "\t"
+		          << (entries[i].type < 4 ? types[entries[i].type] : "?") << "\t"
+		          << entries[i].size << " bytes" << std::endl;
+	}
+	std::cout << header->size << " bytes in store" << std::endl;
+	return 0;
+}
+
+/** Print usage message **/
+void usage() {
+	std::cout << "Gathers AziPOV contents into a content store for the firmware flash" << std::endl
+	          << "    --out|-o <f>    content store to create" << std::endl
+	          << "    --max <bytes>   fail if store is larger (default 393216, flash of the F401RE store)" << std::endl
+	          << "    --list <f>      print contents of a store" << std::endl
+	          << "    <name>=<file>   content to add, named after file without extension when name is omitted" << std::endl
+	          << std::endl
+	          << "Sample command line: -o content.azpd star=star.azps spiral.azps anim.azpa" << std::endl
+	          << "                     --list content.azpd" << std::endl;
+}
+
+/** Main function used as entry point **/
+int main(int argc, char * argv[]) {
+	const char * out = nullptr;
+	size_t max = 384 * 1024;
+	int c;
+	int option_index = 0;
+	struct option options[] = {
+		{"out", required_argument, 0, 'o'},
+		{"help", no_argument, 0, 0x01},
+		{"max", required_argument, 0, 0x02},
+		{"list", required_argument, 0, 0x03},
+		{0, 0, 0, 0}
+	};
+	while((c = getopt_long(argc, argv, "o:", options, &option_index)) != -1) {
+		if (c == 'o') {
+			out = optarg;
+		} else if (c == 0x01) {
+			usage();
+			return 2;
+		} else if (c == 0x02) {
+			max = strtoul(optarg, NULL, 10);
+		} else if (c == 0x03) {
+			return list(optarg);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!out || optind >= argc || argc - optind > UINT16_MAX) {
+		usage();
+		return 1;
+	}
+
+	// Read all contents before writing anything
+	int count = argc - optind;
+	std::vector <std::string> names(count);
+	std::vector <std::vector <uint8_t>> contents(count);
+	for (int i = 0; i < count; ++i) {
+		std::string arg = argv[optind + i];
+		std::string file = arg;
+		size_t equal = arg.find('=');
+		if (equal != std::string::npos) {
+			names[i] = arg.substr(0, equal);
+			file = arg.substr(equal + 1);
+		} else {
+			size_t slash = arg.find_last_of('/');
+			names[i] = arg.substr(slash == std::string::npos ? 0 : slash + 1);
+			names[i] = names[i].substr(0, names[i].find('.'));
+		}
+		if (names[i].empty() || names[i].size() >= STORE_NAME_BYTES) {
+			std::cerr << "ERROR name of " << file << " must have 1 to " << STORE_NAME_BYTES - 1 << " characters" << std::endl;
+			return 1;
+		}
+		for (int j = 0; j < i; ++j) {
+			if (names[j] == names[i]) {
+				std::cerr << "ERROR " << names[i] << " is given twice" << std::endl;
+				return 1;
+			}
+		}
+		std::ifstream f(file, std::ios::binary);
+		contents[i].assign(std::istreambuf_iterator <char> (f), std::istreambuf_iterator <char> ());
+		if (!f.is_open() || contents[i].empty()) {
+			std::cerr << "ERROR cannot read " << file << std::endl;
+			return 3;
+		}
+	}
+
+	// Directory, then data aligned to 4 bytes
+	std::vector <uint8_t> store;
+	size_t offset = sizeof(struct store_header) + count * sizeof(struct store_entry);
+	for (int i = 0; i < count; ++i) {
+		char name[STORE_NAME_BYTES] = {0};
+		strncpy(name, names[i].c_str(), STORE_NAME_BYTES - 1);
+		store.insert(store.end(), name, name + STORE_NAME_BYTES);
+		append_le(store, content_type(contents[i]), 2);
+		append_le(store, 0, 2);
+		append_le(store, offset, 4);
+		append_le(store, contents[i].size(), 4);
+		offset += (contents[i].size() + 3) / 4 * 4;
+	}
+	for (int i = 0; i < count; ++i) {
+		store.insert(store.end(), contents[i].begin(), contents[i].end());
+		store.resize((store.size() + 3) / 4 * 4, 0);
+	}
+	if (offset > max || offset > UINT32_MAX) {
+		std::cerr << "ERROR store needs " << offset << " bytes, more than " << max << std::endl;
+		return 3;
+	}
+
+	std::vector <uint8_t> header;
+	header.insert(header.end(), STORE_MAGIC, STORE_MAGIC + 4);
+	append_le(header, STORE_VERSION, 2);
+	append_le(header, count, 2);
+	append_le(header, offset, 4);
+	append_le(header, store_crc32(0, store.data(), store.size()), 4);
+
+	std::ofstream f(out, std::ios::binary);
+	f.write((const char *) header.data(), header.size());
+	f.write((const char *) store.data(), store.size());
+	if (!f) {
+		std::cerr << "ERROR cannot write " << out << std::endl;
+		return 3;
+	}
+	return 0;
+}
@@ -0,0 +1,77 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+	if (!threads)
+		threads = std::thread::hardware_concurrency();
+	for (unsigned i = 1; i < threads; ++i)
+		workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard <std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread & t: workers)
+		t.join();
+}
+
+void ThreadPool::parallel_for(size_t count, size_t chunk, const std::function <void(size_t, size_t)> & body) {
+	if (!count)
+		return;
+	if (!chunk)
+		chunk = 1;
+	if (workers.empty() || count <= chunk) {
+		body(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard <std::mutex> lock(mutex);
+		this->body = &body;
+		this->count = count;
+		this->chunk = chunk;
+		next = 0;
+		remaining = (count + chunk - 1) / chunk;
+		++generation;
+	}
+	wake.notify_all();
+
+	// Caller takes its share of chunks, then waits for workers still running one
+	run_chunks();
+	std::unique_lock <std::mutex> lock(mutex);
+	done.wait(lock, [this] { return remaining == 0; });
+	this->body = nullptr;
+}
+
+void ThreadPool::run_chunks() {
+	std::unique_lock <std::mutex> lock(mutex);
+	while (body && next < count) {
+		size_t begin = next;
+		size_t end = (count - begin > chunk) ? begin + chunk : count;
+		next = end;
+		const std::function <void(size_t, size_t)> & f = *body;
+
+		lock.unlock();
+		f(begin, end);
+		lock.lock();
+
+		if (--remaining == 0)
+			done.notify_all();
+	}
+}
+
+void ThreadPool::work() {
+	unsigned seen = 0;
+	while (true) {
+		{
+			std::unique_lock <std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+		}
+		run_chunks();
+	}
+}
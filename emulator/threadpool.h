@@ -0,0 +1,56 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+/** Set of worker threads sharing the chunks of a loop **/
+class ThreadPool {
+	public:
+		/** Start worker threads
+		  * @param [in] threads Number of threads including caller, 0 to match hardware
+		  */
+		explicit ThreadPool(unsigned threads = 0);
+
+		/** Stop worker threads **/
+		~ThreadPool();
+
+		/** Give number of threads running loops, including caller
+		  * @return Number of threads
+		  */
+		unsigned size() const { return workers.size() + 1; }
+
+		/** Run a loop body over a range split in chunks, and wait for all of them
+		  * @param [in] count Size of the range, starting at 0
+		  * @param [in] chunk Maximum number of iterations in a chunk
+		  * @param [in] body  Function called with begin and end of each chunk
+		  */
+		void parallel_for(size_t count, size_t chunk, const std::function <void(size_t, size_t)> & body);
+
+	private:
+		/** Run chunks of current loop until none is left **/
+		void run_chunks();
+
+		/** Worker thread main loop **/
+		void work();
+
+		std::vector <std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wake; // Signaled when a loop starts or pool stops
+		std::condition_variable done; // Signaled when last chunk of a loop ends
+		bool stopping = false;
+		unsigned generation = 0; // Incremented for each loop
+
+		// Current loop
+		const std::function <void(size_t, size_t)> * body = nullptr;
+		size_t count = 0;
+		size_t chunk = 1;
+		size_t next = 0; // Start of next chunk to run
+		size_t remaining = 0; // Number of chunks not finished yet
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,230 @@
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <chrono>
+#include <getopt.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "store.h"
+#include "upload.h"
+
+/** Open a serial device in raw mode
+  * @param [in] device Serial device, or pseudo terminal
+  * @param [in] baud   Speed in bauds
+  * @return File descriptor, -1 on error
+  */
+int open_serial(const char * device, unsigned baud) {
+	static const struct { unsigned baud; speed_t speed; } speeds[] = {
+		{115200, B115200}, {230400, B230400}, {460800, B460800}, {921600, B921600},
+		{1000000, B1000000}, {1500000, B1500000}, {2000000, B2000000}, {3000000, B3000000}
+	};
+	speed_t speed = 0;
+	for (auto & s: speeds) {
+		if (s.baud == baud)
+			speed = s.speed;
+	}
+	if (!speed) {
+		std::cerr << "ERROR unsupported speed " << baud << std::endl;
+		return -1;
+	}
+
+	int fd = open(device, O_RDWR | O_NOCTTY);
+	if (fd < 0)
+		return -1;
+	struct termios tio;
+	if (tcgetattr(fd, &tio) < 0) {
+		close(fd);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	if (tcsetattr(fd, TCSANOW, &tio) < 0) {
+		close(fd);
+		return -1;
+	}
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+
+/** Write all bytes
+  * @return false on error
+  */
+bool write_all(int fd, const uint8_t * data, size_t length) {
+	while (length) {
+		ssize_t n = write(fd, data, length);
+		if (n < 0)
+			return false;
+		data += n;
+		length -= n;
+	}
+	return true;
+}
+
+/** Wait for an acknowledgement
+  * @param [in]     fd      Serial device
+  * @param [in,out] parser  Frame decoding state
+  * @param [in]     timeout Time to wait in milliseconds
+  * @param [out]    status  Status of acknowledgement
+  * @param [out]    seq     Next frame expected by board
+  * @return false on timeout or error
+  */
+bool wait_ack(int fd, upload_parser & parser, int timeout, uint8_t & status, uint8_t & seq) {
+	auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+	for (;;) {
+		int left = std::chrono::duration_cast <std::chrono::milliseconds> (end - std::chrono::steady_clock::now()).count();
+		if (left < 0)
+			return false;
+		struct pollfd p = {fd, POLLIN, 0};
+		if (poll(&p, 1, left) < 0)
+			return false;
+		uint8_t byte;
+		while (read(fd, &byte, 1) == 1) {
+			if (upload_parse(&parser, byte) && parser.frame[2] == UPLOAD_ACK && (parser.frame[4] | parser.frame[5] << 8) >= 2) {
+				status = parser.frame[UPLOAD_HEADER_BYTES];
+				seq = parser.frame[UPLOAD_HEADER_BYTES + 1];
+				return true;
+			}
+		}
+	}
+}
+
+/** Give message of an acknowledgement status **/
+const char * status_message(uint8_t status) {
+	switch (status) {
+	case UPLOAD_REFUSED: return "frame refused";
+	case UPLOAD_TOO_LARGE: return "store too large for board";
+	case UPLOAD_FLASH_ERROR: return "flash error";
+	case UPLOAD_BAD_IMAGE: return "store damaged on the way";
+	default: return "unknown error";
+	}
+}
+
+/** Print usage message **/
+void usage() {
+	std::cout << "Uploads a content store to the board over its serial link" << std::endl
+	          << "    --dev|-d <f>    serial device, or pseudo terminal of azipov_board (default /dev/ttyACM0)" << std::endl
+	          << "    --baud <b>      speed in bauds (default 2000000)" << std::endl
+	          << "    --window <n>    frames sent ahead of acknowledgements, 1 to " << UPLOAD_WINDOW << " (default " << UPLOAD_WINDOW << ")" << std::endl
+	          << std::endl
+	          << "Sample command line: -d /dev/ttyACM0 content.azpd" << std::endl;
+}
+
+/** Main function used as entry point **/
+int main(int argc, char * argv[]) {
+	const char * device = "/dev/ttyACM0";
+	unsigned baud = UPLOAD_BAUD;
+	size_t window = UPLOAD_WINDOW;
+	int c;
+	int option_index = 0;
+	struct option options[] = {
+		{"dev", required_argument, 0, 'd'},
+		{"help", no_argument, 0, 0x01},
+		{"baud", required_argument, 0, 0x02},
+		{"window", required_argument, 0, 0x03},
+		{0, 0, 0, 0}
+	};
+	while((c = getopt_long(argc, argv, "d:", options, &option_index)) != -1) {
+		if (c == 'd') {
+			device = optarg;
+		} else if (c == 0x01) {
+			usage();
+			return 2;
+		} else if (c == 0x02) {
+			baud = strtoul(optarg, NULL, 10);
+		} else if (c == 0x03) {
+			window = strtoul(optarg, NULL, 10);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (optind + 1 != argc || window < 1 || window > UPLOAD_WINDOW) {
+		usage();
+		return 1;
+	}
+
+	const char * name = argv[optind];
+	std::ifstream f(name, std::ios::binary);
+	std::vector <uint8_t> image((std::istreambuf_iterator <char> (f)), std::istreambuf_iterator <char> ());
+	if (!f.is_open() || !store_check((const struct store_header *) image.data(), image.size(), 1)) {
+		std::cerr << "ERROR " << name << " is not a valid content store" << std::endl;
+		return 3;
+	}
+	int fd = open_serial(device, baud);
+	if (fd < 0) {
+		std::cerr << "ERROR cannot open " << device << std::endl;
+		return 3;
+	}
+
+	// Frame 0 begins, then data frames, then end
+	std::vector <std::vector <uint8_t>> frames;
+	uint8_t payload[UPLOAD_MAX_PAYLOAD];
+	uint8_t frame[UPLOAD_MAX_FRAME];
+	upload_put_u32(payload, image.size());
+	upload_put_u32(payload + 4, store_crc32(0, image.data(), image.size()));
+	frames.emplace_back(frame, frame + upload_encode(UPLOAD_BEGIN, 0, payload, 8, frame));
+	for (size_t offset = 0; offset < image.size(); offset += UPLOAD_MAX_DATA) {
+		size_t n = std::min <size_t> (UPLOAD_MAX_DATA, image.size() - offset);
+		upload_put_u32(payload, offset);
+		memcpy(payload + 4, &image[offset], n);
+		frames.emplace_back(frame, frame + upload_encode(UPLOAD_DATA, frames.size(), payload, 4 + n, frame));
+	}
+	frames.emplace_back(frame, frame + upload_encode(UPLOAD_END, frames.size(), payload, 0, frame));
+
+	// Board erases flash before acknowledging first frame, up to 4 s per sector
+	auto start = std::chrono::steady_clock::now();
+	upload_parser parser = {};
+	size_t base = 0, next = 0;
+	int retries = 0;
+	while (base < frames.size()) {
+		size_t ahead = (base == 0) ? 1 : window;
+		while (next < frames.size() && next - base < ahead) {
+			if (!write_all(fd, frames[next].data(), frames[next].size())) {
+				std::cerr << "ERROR cannot write to " << device << std::endl;
+				return 3;
+			}
+			++next;
+		}
+
+		uint8_t status, seq;
+		if (!wait_ack(fd, parser, base == 0 ? 15000 : 200, status, seq)) {
+			if (++retries > 10) {
+				std::cerr << "ERROR board does not answer" << std::endl;
+				return 3;
+			}
+			next = base;
+			continue;
+		}
+		if (status != UPLOAD_OK && status != UPLOAD_RESEND) {
+			std::cerr << "ERROR " << status_message(status) << std::endl;
+			return 3;
+		}
+
+		// Board expects frame seq, somewhere from base to next
+		for (size_t i = base; i <= next; ++i) {
+			if ((i & 0xff) == seq) {
+				if (i > base)
+					retries = 0;
+				base = i;
+				break;
+			}
+		}
+		if (status == UPLOAD_RESEND)
+			next = base;
+	}
+
+	double seconds = std::chrono::duration <double> (std::chrono::steady_clock::now() - start).count();
+	std::cout << image.size() << " bytes uploaded in " << seconds << " s, "
+	          << (size_t) (image.size() / seconds) << " bytes/s" << std::endl;
+	close(fd);
+	return 0;
+}
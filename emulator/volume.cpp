@@ -0,0 +1,226 @@
+#include "volume.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(sizeof(color) == 3, "voxels are stored as packed RGB");
+
+Volume::~Volume() {
+	volume_release(*this);
+}
+
+void volume_release(Volume & volume) {
+	if (volume.mapping)
+		munmap(volume.mapping, volume.mapping_length);
+	volume.mapping = nullptr;
+	volume.mapping_length = 0;
+	volume.storage.clear();
+	volume.storage.shrink_to_fit();
+	volume.column_min.clear();
+	volume.column_max.clear();
+	volume.voxels = nullptr;
+	volume.size_x = volume.size_y = volume.size_z = 0;
+}
+
+void volume_fill(Volume & volume, int x, int y, int z, color c) {
+	volume_release(volume);
+	volume.size_x = x;
+	volume.size_y = y;
+	volume.size_z = z;
+	volume.storage.assign((size_t) x * y * z, c);
+	volume.voxels = volume.storage.data();
+	volume_index(volume);
+}
+
+void volume_index(Volume & volume) {
+	size_t columns = (size_t) volume.size_x * volume.size_y;
+	volume.column_min.assign(columns, volume.size_z);
+	volume.column_max.assign(columns, 0);
+	for (size_t c = 0; c < columns; ++c) {
+		const color * column = volume.voxels + c * volume.size_z;
+		for (int z = 0; z < volume.size_z; ++z) {
+			if (column[z].r || column[z].g || column[z].b) {
+				if (volume.column_min[c] > z)
+					volume.column_min[c] = z;
+				volume.column_max[c] = z;
+			}
+		}
+	}
+}
+
+/** Count voxels of run-length encoded data
+  * @param [in] data   Encoded voxels
+  * @param [in] length Length of encoded voxels
+  * @return Number of voxels, SIZE_MAX if data is cut in a run
+  */
+static size_t count_rle(const unsigned char * data, size_t length) {
+	const unsigned char * end = data + length;
+	size_t count = 0;
+	while (data < end) {
+		unsigned char code = *data++;
+		if (code < 0x80) {
+			count += code + 1;
+		} else {
+			size_t n = code - 0x7f;
+			if ((size_t) (end - data) < n * 3)
+				return SIZE_MAX;
+			data += n * 3;
+			count += n;
+		}
+	}
+	return count;
+}
+
+bool volume_decode_rle(const unsigned char * data, size_t length, color * voxels, size_t count) {
+	const unsigned char * end = data + length;
+	size_t i = 0;
+	while (data < end) {
+		unsigned char code = *data++;
+		if (code < 0x80) {
+			size_t n = code + 1;
+			if (i + n > count)
+				return false;
+			std::fill(voxels + i, voxels + i + n, color{0, 0, 0});
+			i += n;
+		} else {
+			size_t n = code - 0x7f;
+			if (i + n > count || (size_t) (end - data) < n * 3)
+				return false;
+			memcpy(voxels + i, data, n * 3);
+			data += n * 3;
+			i += n;
+		}
+	}
+	return i == count;
+}
+
+void volume_encode_rle(const color * voxels, size_t count, std::vector <unsigned char> & data) {
+	data.clear();
+	size_t i = 0;
+	while (i < count) {
+		size_t n = 0;
+		if (!voxels[i].r && !voxels[i].g && !voxels[i].b) {
+			while (i + n < count && n < 0x80 && !voxels[i + n].r && !voxels[i + n].g && !voxels[i + n].b)
+				++n;
+			data.push_back(n - 1);
+		} else {
+			while (i + n < count && n < 0x80 && (voxels[i + n].r || voxels[i + n].g || voxels[i + n].b))
+				++n;
+			data.push_back(n + 0x7f);
+			data.insert(data.end(), (const unsigned char *) (voxels + i), (const unsigned char *) (voxels + i + n));
+		}
+		i += n;
+	}
+}
+
+/** Read a little endian 16 bits value
+  * @param [in] p Bytes to read
+  * @return Value
+  */
+static uint16_t read_u16(const unsigned char * p) {
+	return p[0] | (p[1] << 8);
+}
+
+/** Find volume dimensions and voxels in file content
+  * @param [in]  data   File content
+  * @param [in]  length Length of file content
+  * @param [out] x      Number of voxels along X
+  * @param [out] y      Number of voxels along Y
+  * @param [out] z      Number of voxels along Z
+  * @param [out] offset Offset of voxels in file content
+  * @param [out] rle    Are voxels run-length encoded
+  * @return false if content is not a volume
+  */
+static bool parse_header(const unsigned char * data, size_t length, int & x, int & y, int & z, size_t & offset, bool & rle) {
+	offset = 0;
+	rle = length >= VOLUME_HEADER_SIZE && !memcmp(data, VOLUME_RLE_MAGIC, 4);
+	if (length >= VOLUME_HEADER_SIZE && (rle || !memcmp(data, VOLUME_MAGIC, 4))) {
+		if (read_u16(data + 4) != VOLUME_VERSION)
+			return false;
+		x = read_u16(data + 6);
+		y = read_u16(data + 8);
+		z = read_u16(data + 10);
+		offset = VOLUME_HEADER_SIZE;
+		if (rle)
+			return x && y && z;
+	} else {
+		// No header, guess cube side from file size
+		x = y = z = lround(cbrt(length / 3));
+	}
+	return x && y && z && length - offset == (size_t) x * y * z * 3;
+}
+
+bool volume_load(Volume & volume, const char * filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return false;
+	}
+
+	// Regular files are used in place, others (pipes...) are read in memory
+	void * mapping = MAP_FAILED;
+	size_t length = st.st_size;
+	std::vector <unsigned char> content;
+	if (S_ISREG(st.st_mode) && length)
+		mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapping == MAP_FAILED) {
+		unsigned char buffer[65536];
+		ssize_t r;
+		while ((r = read(fd, buffer, sizeof(buffer))) > 0)
+			content.insert(content.end(), buffer, buffer + r);
+		length = content.size();
+	}
+	close(fd);
+
+	const unsigned char * data = (mapping != MAP_FAILED) ? (const unsigned char *) mapping : content.data();
+	int x, y, z;
+	size_t offset;
+	bool rle;
+	if (!parse_header(data, length, x, y, z, offset, rle)) {
+		if (mapping != MAP_FAILED)
+			munmap(mapping, length);
+		return false;
+	}
+
+	volume_release(volume);
+	volume.size_x = x;
+	volume.size_y = y;
+	volume.size_z = z;
+	if (rle) {
+		// Encoded voxels cannot be used in place. Dimensions are only
+		// trusted once the data holds that many voxels.
+		if (count_rle(data + offset, length - offset) != (size_t) x * y * z) {
+			if (mapping != MAP_FAILED)
+				munmap(mapping, length);
+			volume_release(volume);
+			return false;
+		}
+		volume.storage.resize((size_t) x * y * z);
+		volume.voxels = volume.storage.data();
+		bool ok = volume_decode_rle(data + offset, length - offset, volume.storage.data(), volume.storage.size());
+		if (mapping != MAP_FAILED)
+			munmap(mapping, length);
+		if (!ok) {
+			volume_release(volume);
+			return false;
+		}
+	} else if (mapping != MAP_FAILED) {
+		volume.mapping = mapping;
+		volume.mapping_length = length;
+		volume.voxels = (const color *) (data + offset);
+	} else {
+		volume.storage.assign((const color *) (data + offset), (const color *) (data + length));
+		volume.voxels = volume.storage.data();
+	}
+	// Voxels read in memory are indexed now, mapped ones when first needed
+	if (!volume.mapping)
+		volume_index(volume);
+	return true;
+}
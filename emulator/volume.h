@@ -0,0 +1,107 @@
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/** Color **/
+struct color {
+	uint8_t r; // Red
+	uint8_t g; // Green
+	uint8_t b; // Blue
+};
+
+/** Volume file layout
+  * A volume file starts with a 12 bytes header, all fields little endian:
+  *   char magic[4]   "AZPV"
+  *   uint16 version  VOLUME_VERSION
+  *   uint16 size_x   Number of voxels along X
+  *   uint16 size_y   Number of voxels along Y
+  *   uint16 size_z   Number of voxels along Z
+  * followed by size_x * size_y * size_z RGB voxels, X major then Y then Z.
+  *
+  * Files without header are read as a cube of RGB voxels in the same order,
+  * as written by the first picture generators (24x24x24).
+  *
+  * Run-length encoded volumes have the same header with "AZPR" magic, followed
+  * by voxels in the same order encoded as a sequence of:
+  *   0x00..0x7f     n + 1 black voxels
+  *   0x80..0xff     n - 0x7f voxels, whose RGB values follow
+  */
+#define VOLUME_MAGIC "AZPV"
+#define VOLUME_RLE_MAGIC "AZPR"
+#define VOLUME_VERSION 1
+#define VOLUME_HEADER_SIZE 12
+
+/** Colors of a box of voxels
+  * Voxels of a volume read from a file are used in place from a read-only mapping of the file
+  */
+struct Volume {
+	int size_x = 0; // Number of voxels along X
+	int size_y = 0; // Number of voxels along Y
+	int size_z = 0; // Number of voxels along Z
+	const color * voxels = nullptr; // Voxel (x, y, z) is voxels[(x * size_y + y) * size_z + z]
+
+	std::vector <color> storage; // Voxels owned by volume, if not mapped
+	void * mapping = nullptr; // Mapped file, if any
+	size_t mapping_length = 0; // Length of mapped file
+
+	// Occupancy of each column of voxels along Z, column (x, y) is at x * size_y + y
+	// Empty for volumes mapped in place until volume_index() is called
+	std::vector <uint16_t> column_min; // Lowest non black voxel, size_z if column is black
+	std::vector <uint16_t> column_max; // Highest non black voxel, 0 if column is black
+
+	Volume() = default;
+	Volume(const Volume &) = delete;
+	Volume & operator=(const Volume &) = delete;
+	~Volume();
+
+	const color & at(int x, int y, int z) const { return voxels[((size_t) x * size_y + y) * size_z + z]; }
+};
+
+/** Resize volume and fill it with a single color
+  * @param [out] volume Volume to fill
+  * @param [in]  x      Number of voxels along X
+  * @param [in]  y      Number of voxels along Y
+  * @param [in]  z      Number of voxels along Z
+  * @param [in]  c      Color of all voxels
+  */
+void volume_fill(Volume & volume, int x, int y, int z, color c);
+
+/** Release voxels of a volume and make it empty
+  * @param [in,out] volume Volume to release
+  */
+void volume_release(Volume & volume);
+
+/** Compute occupancy of volume columns, after its voxels changed or before
+  * first use of a volume mapped in place: reads every voxel
+  * @param [in,out] volume Volume to index
+  */
+void volume_index(Volume & volume);
+
+/** Decode run-length encoded voxels
+  * @param [in]  data   Encoded voxels
+  * @param [in]  length Length of encoded voxels
+  * @param [out] voxels Decoded voxels
+  * @param [in]  count  Number of voxels to decode
+  * @return false if data does not hold exactly count voxels
+  */
+bool volume_decode_rle(const unsigned char * data, size_t length, color * voxels, size_t count);
+
+/** Run-length encode voxels
+  * @param [in]  voxels Voxels to encode
+  * @param [in]  count  Number of voxels
+  * @param [out] data   Encoded voxels
+  */
+void volume_encode_rle(const color * voxels, size_t count, std::vector <unsigned char> & data);
+
+/** Map volume from a file, with or without header
+  * Voxels of a mapped file are not read, its columns are not indexed
+  * @param [out] volume   Volume to read
+  * @param [in]  filename Name of file to read
+  * @return false if file cannot be read or is not a volume
+  */
+bool volume_load(Volume & volume, const char * filename);
+
+#endif // VOLUME_H
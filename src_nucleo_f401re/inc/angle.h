@@ -0,0 +1,97 @@
+#ifndef ANGLE_H
+#define ANGLE_H
+
+#include <stdint.h>
+#include "mbed.h"
+
+/** Rotor angle, tracked from a hall sensor pulse at each revolution
+  * The index interrupt timestamps each pulse with the microsecond ticker and
+  * filters the revolution period and its change, to predict the next period.
+  * Between two pulses, angle is extrapolated from the time elapsed since last
+  * pulse, so that it restarts from 0 exactly on each pulse and stays phase
+  * locked when rotor speed changes.
+  */
+class AngleTracker {
+	public:
+		/** Prepare tracking, without enabling the interrupt yet
+		  * @param [in] pin   Input of hall sensor, rising at index position
+		  * @param [in] steps Number of angle steps in a revolution
+		  */
+		AngleTracker(PinName pin, uint32_t steps);
+
+		/** Enable index interrupt **/
+		void start();
+
+		/** Give angle step at a given time
+		  * @param [in] now Time from us_ticker_read()
+		  * @return Angle step, below steps, or 0 if rotor speed is not known
+		  */
+		uint32_t step(uint32_t now) const;
+
+		/** Give current angle step
+		  * @return Angle step, below steps, or 0 if rotor speed is not known
+		  */
+		uint32_t step() const { return step(us_ticker_read()); }
+
+		/** Give time at which an angle step starts in current revolution
+		  * @param [in] step Angle step, below steps
+		  * @return Time comparable to us_ticker_read(), or time of last index if rotor speed is not known
+		  */
+		uint32_t time_of(uint32_t step) const;
+
+		/** Give filtered revolution period
+		  * @return Period in microseconds, 0 if rotor speed is not known
+		  */
+		uint32_t period() const;
+
+		/** Give filtered rotor speed
+		  * @return Revolutions per minute, 0 if rotor speed is not known
+		  */
+		uint32_t rpm() const;
+
+		/** Give number of index pulses seen so far
+		  * @return Number of revolutions
+		  */
+		uint32_t revolutions() const { return count; }
+
+		/** Call a member function at each index pulse, from the interrupt, once state is updated
+		  * @param [in] object Object to call
+		  * @param [in] member Member function to call
+		  */
+		template <typename T>
+		void attach(T * object, void (T::*member)()) { revolution.attach(object, member); }
+
+		/** Give number of angle steps in a revolution
+		  * @return Number of steps
+		  */
+		uint32_t steps() const { return nsteps; }
+
+	private:
+		/** Index interrupt handler **/
+		void index();
+
+		/** State updated by index() at each revolution **/
+		struct State {
+			uint32_t last; // Time of last index pulse
+			uint32_t period; // Filtered period in microseconds, 0 if not locked
+			uint32_t rate; // Angle steps per microsecond, 32 fractional bits
+			uint32_t interval; // Microseconds per angle step, 16 fractional bits
+		};
+
+		/** Give a consistent copy of state, even from an interrupt preempting index()
+		  * @return State of last revolution
+		  */
+		State read() const;
+
+		InterruptIn input; // Hall sensor
+		uint32_t nsteps; // Number of angle steps in a revolution
+		volatile State states[2]; // index() writes the one not in use, then switches to it
+		volatile uint32_t current; // State in use
+		volatile uint32_t count; // Number of revolutions
+		uint32_t filtered; // Filtered period of last revolution, even when not locked yet
+		int32_t slope; // Filtered change of period at each revolution
+		uint32_t good; // Number of consecutive periods in agreement with filter
+		FunctionPointer revolution; // Called at each index pulse
+};
+
+#endif // ANGLE_H
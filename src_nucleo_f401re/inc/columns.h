@@ -0,0 +1,65 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <stdint.h>
+#include "mbed.h"
+#include "angle.h"
+
+/** Column clock, interrupting at each angle step of the rotor
+  * Runs on TIM9, which neither us_ticker nor PwmOut use. At each index pulse
+  * the prescaler and auto-reload are computed from the predicted revolution
+  * period and the counter restarts on column 0, so that columns are spaced by
+  * the hardware instead of going through the sorted Ticker list. Fractions of
+  * a timer tick are spread over columns by dithering the auto-reload.
+  * If the rotor is slower than predicted, the clock stops after the last column
+  * and waits for the next pulse.
+  */
+class ColumnClock {
+	public:
+		/** Prepare clock, without starting the timer yet
+		  * @param [in] angle Angle tracker giving revolution period, one step per column
+		  */
+		ColumnClock(AngleTracker & angle);
+
+		/** Call a function at each column, from the timer interrupt
+		  * The interrupt may use FreeRTOS FromISR functions.
+		  * @param [in] handler Function given column number, or NULL
+		  */
+		void attach(void (*handler)(uint32_t column)) { callback = handler; }
+
+		/** Enable timer and follow index pulses **/
+		void start();
+
+		/** Give last column started
+		  * @return Column, below angle steps
+		  */
+		uint32_t column() const { return current; }
+
+		/** Give number of columns in a revolution
+		  * @return Number of angle steps
+		  */
+		uint32_t columns() const { return angle.steps(); }
+
+	private:
+		/** Restart on column 0 with timing of next revolution, called at each index pulse **/
+		void sync();
+
+		/** Start next column, called at each update of the timer **/
+		void update();
+
+		/** Timer interrupt handler **/
+		static void irq();
+
+		static ColumnClock * instance; // Clock served by irq()
+
+		AngleTracker & angle; // Source of revolution period
+		void (*callback)(uint32_t column); // Handler of each column
+		uint32_t clock; // Timer input clock in Hz
+		volatile uint32_t base; // Timer ticks per column, integer part
+		volatile uint32_t fraction; // Timer ticks per column, fractional part on 16 bits
+		volatile bool restart; // Next update is column 0 of a new revolution
+		volatile uint32_t current; // Last column started
+		uint32_t accumulator; // Sum of fractional parts not spent yet, 16 bits
+};
+
+#endif // COLUMNS_H
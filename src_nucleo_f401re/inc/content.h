@@ -0,0 +1,118 @@
+#ifndef CONTENT_H
+#define CONTENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "store.h"
+#include "slices.h"
+
+/** Content store in flash, read in place
+  * The store lives in its own flash region (section .store of the linker
+  * script), written by "make deploy-store" or over the serial link. Contents
+  * are given as pointers into flash: nothing is copied to RAM, and switching
+  * content is a single write, seen by the renderer at its next column.
+  */
+class ContentStore {
+	public:
+		/** Find store in its flash region, checking its directory and CRC **/
+		ContentStore();
+
+		/** Find store again, after it was written, reading it whole
+		  * @return true if directory and CRC are valid
+		  */
+		bool open();
+
+		/** Stop using the store before writing it: nothing is selected until open() **/
+		void close();
+
+		/** Close the store and erase flash for a new one
+		  * Code runs from flash too: the CPU stalls for up to a few seconds.
+		  * @param [in] size Number of bytes of new store
+		  * @return false if store does not fit or flash cannot be erased
+		  */
+		bool erase(uint32_t size);
+
+		/** Write bytes of a new store to erased flash
+		  * @param [in] offset Offset from start of store, multiple of 4
+		  * @param [in] data   Bytes of store
+		  * @param [in] length Number of bytes, a multiple of 4 but for the last bytes of store
+		  * @return false if bytes do not fit or flash cannot be written
+		  */
+		bool program(uint32_t offset, const uint8_t * data, uint32_t length);
+
+		/** Check flash region against a store sent
+		  * @param [in] size Number of bytes of store, as announced
+		  * @param [in] crc  CRC-32 of all bytes of store, as announced
+		  * @return true if flash holds these bytes, and a store of this size
+		  */
+		bool written(uint32_t size, uint32_t crc) const;
+
+		/** Give size of flash region
+		  * @return Largest store in bytes
+		  */
+		size_t capacity() const { return room; }
+
+		/** Check if a store was found
+		  * @return true if directory and CRC are valid
+		  */
+		bool valid() const { return header != NULL; }
+
+		/** Check CRC of all contents, reading the whole store
+		  * @return true if store is whole
+		  */
+		bool verify() const;
+
+		/** Give number of contents
+		  * @return Number of contents, 0 without store
+		  */
+		uint16_t count() const { return header ? header->entries : 0; }
+
+		/** Give a content
+		  * @param [in] index Content, below count()
+		  * @return Directory entry of content
+		  */
+		const struct store_entry * entry(uint16_t index) const { return store_entries(header) + index; }
+
+		/** Give data of a content
+		  * @param [in] index Content, below count()
+		  * @return First byte of content, in flash
+		  */
+		const void * data(uint16_t index) const { return store_data(header, entry(index)); }
+
+		/** Find a content by name
+		  * @param [in] name Name of content
+		  * @return Index of content, -1 if there is none
+		  */
+		int find(const char * name) const { return header ? store_find(header, name) : -1; }
+
+		/** Select content to show
+		  * @param [in] index Content, below count()
+		  * @return false if content cannot be shown
+		  */
+		bool select(uint16_t index);
+
+		/** Select next content that can be shown, going back to first after last
+		  * @return false if there is none
+		  */
+		bool next();
+
+		/** Give selected slice table
+		  * @return Slice table in flash, NULL if none is selected
+		  */
+		const struct slices_header * slices() const { return selected; }
+
+		/** Give number of times a content was selected or the store closed,
+		  * to notice a store written again at the same place
+		  * @return Counter of switches
+		  */
+		uint32_t switches() const { return switched; }
+
+	private:
+		const struct store_header * header; // Store, NULL if not valid
+		size_t room; // Bytes of flash region
+		int current; // Index of selected content, -1 if none
+		const struct slices_header * volatile selected; // Selected slice table
+		volatile uint32_t switched; // Number of switches
+};
+
+#endif // CONTENT_H
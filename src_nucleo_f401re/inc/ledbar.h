@@ -0,0 +1,91 @@
+#ifndef LEDBAR_H
+#define LEDBAR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mbed.h"
+
+/** Led chips of a bar
+  * APA102 frames start with 32 zero bits, then each led is 0xe0 | brightness,
+  * blue, green, red, and enough clock edges follow for data to reach the last
+  * led. WS2801 frames are red, green, blue of each led, latched once the clock
+  * stays low for 500 us.
+  */
+#define LEDBAR_APA102 0
+#define LEDBAR_WS2801 1
+
+/** Led bar, driven by SPI with DMA
+  * Frames are encoded in buffers given by the caller, so that one can be
+  * filled while another goes out in the background.
+  */
+class LedBar {
+	public:
+		/** Prepare SPI
+		  * @param [in] mosi   Data pin
+		  * @param [in] sclk   Clock pin
+		  * @param [in] pixels Number of leds, chained
+		  * @param [in] type   LEDBAR_APA102 or LEDBAR_WS2801
+		  * @param [in] hz     SPI clock frequency
+		  */
+		LedBar(PinName mosi, PinName sclk, uint16_t pixels, int type = LEDBAR_APA102, int hz = 10000000);
+
+		/** Give size of a frame buffer
+		  * @return Number of bytes
+		  */
+		size_t bytes() const { return frame_bytes; }
+
+		/** Give number of leds
+		  * @return Number of leds
+		  */
+		uint16_t pixels() const { return npixels; }
+
+		/** Set all leds of a frame to black, with start and end of frame
+		  * @param [out] frame Frame of bytes() bytes
+		  */
+		void clear(uint8_t * frame) const;
+
+		/** Set color of a led in a frame
+		  * @param [in,out] frame Frame, cleared once
+		  * @param [in]     pixel Led, below pixels()
+		  * @param [in]     rgb   Color of led
+		  */
+		void set(uint8_t * frame, uint16_t pixel, const uint8_t rgb[3]) const {
+			uint8_t * led = frame + offset + pixel * stride;
+			if (type == LEDBAR_APA102) {
+				led[1] = rgb[2];
+				led[2] = rgb[1];
+				led[3] = rgb[0];
+			} else {
+				led[0] = rgb[0];
+				led[1] = rgb[1];
+				led[2] = rgb[2];
+			}
+		}
+
+		/** Send a frame in the background
+		  * @param [in] frame Frame, left untouched until done is called
+		  * @param [in] done  Function called from the DMA interrupt when frame may be reused, or NULL
+		  * @return 0 if sending, -1 if previous frame is still being sent
+		  */
+		int send(const uint8_t * frame, void (*done)(void) = NULL) { return spi.write(frame, frame_bytes, done); }
+
+		/** Set priority of the interrupt calling done
+		  * @param [in] priority NVIC priority, 0 being the highest
+		  */
+		void priority(int priority) { spi.dma_priority(priority); }
+
+		/** Check if a frame is being sent
+		  * @return true until done of last frame is called
+		  */
+		bool busy() { return spi.write_busy(); }
+
+	private:
+		SPI spi; // Bus of the leds
+		uint16_t npixels; // Number of leds
+		int type; // LEDBAR_APA102 or LEDBAR_WS2801
+		size_t offset; // Bytes before first led
+		size_t stride; // Bytes per led
+		size_t frame_bytes; // Bytes of a frame
+};
+
+#endif // LEDBAR_H
@@ -0,0 +1,84 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mbed.h"
+#include "FreeRTOS.h"
+
+/** Bytes of a log message, longer ones are cut **/
+#define LOGGER_SLOT_BYTES 64
+
+/** Log and telemetry output, sent by DMA without ever waiting
+  * Messages go into a ring of slots and the serial port sends each slot by
+  * DMA, right where it was written. Writers claim a slot by counting it with
+  * an exclusive store (LDREX/STREX), then mark it ready: no lock is taken and
+  * interrupts are never masked, so any task or interrupt can log without
+  * delaying the column clock. Slots are sent in order, a slot claimed by a
+  * writer that was preempted holds back the ones after it until it is done.
+  * When the ring is full, messages are dropped and counted.
+  */
+class Logger {
+	public:
+		/** Prepare log, without starting it yet
+		  * @param [in] serial Serial port, its baud rate set; nothing else must write to it
+		  */
+		Logger(RawSerial & serial);
+
+		/** Allocate slots and start sending
+		  * @param [in] slots    Number of slots, a power of 2
+		  * @param [in] priority NVIC priority of the DMA interrupt, below the RTOS syscall limit
+		  * @return false if out of memory or number of slots is not supported
+		  */
+		bool start(unsigned slots = 16, int priority = configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 1);
+
+		/** Log a formatted message, from a task since formatting uses its stack
+		  * @param [in] format Format of printf, message cut to LOGGER_SLOT_BYTES - 1 bytes
+		  * @return false if message was dropped
+		  */
+		bool printf(const char * format, ...) __attribute__((format(printf, 2, 3)));
+
+		/** Log bytes as they are, from a task or any interrupt
+		  * @param [in] data   Bytes, telemetry or frames of a protocol
+		  * @param [in] length Number of bytes, up to LOGGER_SLOT_BYTES
+		  * @return false if bytes were dropped
+		  */
+		bool write(const void * data, size_t length);
+
+		/** Give number of messages dropped
+		  * @return Number of messages
+		  */
+		uint32_t drops() const { return dropped; }
+
+	private:
+		/** Message of the ring **/
+		struct Slot {
+			uint8_t data[LOGGER_SLOT_BYTES]; // Bytes to send
+			uint16_t length; // Number of bytes
+			volatile uint8_t ready; // Written, until sent
+		};
+
+		/** Claim next slot
+		  * @return Slot to write, NULL if ring is full
+		  */
+		Slot * reserve();
+
+		/** Mark a slot ready and send it when its turn comes **/
+		void commit(Slot * slot, size_t length);
+
+		/** Send next slot if nothing is being sent **/
+		void kick();
+
+		/** Free slot sent, from DMA interrupt **/
+		void done();
+
+		RawSerial & serial; // Serial port
+		Slot * slots; // Ring of slots
+		uint32_t mask; // Number of slots - 1
+		volatile uint32_t reserved; // Slots claimed
+		volatile uint32_t sent; // Slots sent, written by sender only
+		volatile uint32_t sending; // 1 while a writer or the DMA sends
+		volatile uint32_t dropped; // Messages dropped
+};
+
+#endif // LOGGER_H
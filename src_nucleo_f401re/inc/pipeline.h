@@ -0,0 +1,91 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "columns.h"
+#include "ledbar.h"
+
+/** Column frames, rendered by a task ahead of the column clock
+  * A ring of frames goes around three owners, each one only moving its own
+  * counter forward:
+  *   the render task fills free frames, tagged with the column at which they
+  *   will be shown, then counts them in filled
+  *   the column interrupt sends the frame of its column to the led bar, drops
+  *   frames whose column has passed, counting both in started
+  *   the end of the transfer frees the frame sent
+  * A counting semaphore holds the number of free frames, so that the task
+  * sleeps until one comes back. Column and DMA interrupts have the same
+  * priority, so they never preempt each other, and frames are freed in ring
+  * order. When no frame is ready at a column, leds keep showing the last one.
+  */
+class ColumnPipeline {
+	public:
+		/** Prepare pipeline, without starting it yet
+		  * @param [in] bar    Led bar showing frames
+		  * @param [in] clock  Column clock, not started yet
+		  * @param [in] render Function filling a frame of the bar for a column, called from the task
+		  */
+		ColumnPipeline(LedBar & bar, ColumnClock & clock, void (*render)(uint32_t column, uint8_t * frame));
+
+		/** Allocate frames, create render task and follow column clock
+		  * @param [in] depth    Number of frames, at least 2
+		  * @param [in] priority Priority of render task
+		  * @return false if out of memory
+		  */
+		bool start(unsigned depth = 2, unsigned priority = tskIDLE_PRIORITY + 3UL);
+
+		/** Give number of columns at which no frame was ready
+		  * @return Number of columns
+		  */
+		uint32_t underruns() const { return missed; }
+
+		/** Give number of columns at which previous frame was still being sent
+		  * @return Number of columns
+		  */
+		uint32_t overruns() const { return busy; }
+
+		/** Give number of frames rendered too late for their column
+		  * @return Number of frames
+		  */
+		uint32_t drops() const { return dropped; }
+
+	private:
+		/** Frame of the ring **/
+		struct Frame {
+			uint8_t * data; // Encoded frame of the led bar
+			uint32_t column; // Column at which it is shown
+		};
+
+		/** Render frames as they are freed **/
+		void run();
+
+		/** Send frame of a column, from column interrupt **/
+		void tick(uint32_t column);
+
+		/** Free frame sent, from DMA interrupt **/
+		void done();
+
+		static void task(void * pipeline);
+		static void on_column(uint32_t column);
+		static void on_done();
+
+		static ColumnPipeline * instance; // Pipeline served by interrupts
+
+		LedBar & bar; // Led bar showing frames
+		ColumnClock & clock; // Column clock
+		void (*render)(uint32_t column, uint8_t * frame); // Fills frames
+		Frame * frames; // Ring of frames
+		unsigned depth; // Number of frames
+		xSemaphoreHandle available; // Number of free frames
+		volatile uint32_t filled; // Frames filled, written by task only
+		volatile uint32_t started; // Frames sent or dropped, written by column interrupt only
+		volatile bool sending; // A frame is being sent
+		volatile uint32_t missed; // Columns without frame
+		volatile uint32_t busy; // Columns with led bar still busy
+		volatile uint32_t dropped; // Frames too late
+};
+
+#endif // PIPELINE_H
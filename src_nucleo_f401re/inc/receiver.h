@@ -0,0 +1,61 @@
+#ifndef RECEIVER_H
+#define RECEIVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mbed.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/** Serial reception in chunks, for one task
+  * The serial port writes bytes by DMA around a ring, without interrupt per
+  * byte. Interrupts come only when the line goes idle after a burst, and at
+  * each half of the ring: they count bytes received and wake the task, which
+  * is given all bytes written so far where they lie in the ring, like a
+  * stream buffer without copy.
+  * Counters run freely, the ring size being a power of 2. A chunk is valid
+  * until the DMA comes back to it, one ring later: when the task falls that
+  * far behind, bytes are lost and counted as an overrun.
+  */
+class SerialReceiver {
+	public:
+		/** Prepare reception, without starting it yet
+		  * @param [in] serial Serial port, its baud rate set
+		  */
+		SerialReceiver(RawSerial & serial);
+
+		/** Allocate ring and start reception
+		  * @param [in] length   Bytes of ring, a power of 2 up to 32768
+		  * @param [in] priority NVIC priority of reception interrupts, below the RTOS syscall limit
+		  * @return false if out of memory or length is not supported
+		  */
+		bool start(size_t length = 4096, int priority = configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY + 1);
+
+		/** Wait for bytes, from the single task reading them
+		  * @param [out] chunk   Received bytes, in the ring
+		  * @param [in]  timeout Ticks to wait for a chunk
+		  * @return Number of bytes of chunk, 0 on timeout
+		  */
+		size_t receive(const uint8_t ** chunk, portTickType timeout = portMAX_DELAY);
+
+		/** Give number of times bytes were lost, the task being a ring late
+		  * @return Number of overruns
+		  */
+		uint32_t overruns() const { return lost; }
+
+	private:
+		/** Count bytes received, from interrupts **/
+		void update();
+
+		RawSerial & serial; // Serial port
+		uint8_t * ring; // Written by DMA
+		size_t length; // Bytes of ring
+		xSemaphoreHandle ready; // Given when bytes come
+		size_t position; // Position of DMA at last interrupt, written by interrupts only
+		volatile uint32_t received; // Bytes received, written by interrupts only
+		uint32_t taken; // Bytes given to the task
+		volatile uint32_t lost; // Overruns
+};
+
+#endif // RECEIVER_H
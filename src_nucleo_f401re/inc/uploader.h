@@ -0,0 +1,73 @@
+#ifndef UPLOADER_H
+#define UPLOADER_H
+
+#include <stdint.h>
+#include "mbed.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "upload.h"
+#include "content.h"
+#include "receiver.h"
+#include "logger.h"
+
+/** Bytes of the reception ring, room for a whole window of frames **/
+#define UPLOADER_RING_BYTES 4096
+
+/** Content store uploads over a serial port
+  * A task takes received bytes in chunks (SerialReceiver) to decode frames
+  * of the upload protocol (upload.h) and write the store to flash.
+  * Acknowledgements go out through the log, which owns transmission: the
+  * host skips log text between frames. The host
+  * never has more than a window of frames in flight, so the ring does not
+  * overflow while the task waits for flash.
+  */
+class Uploader {
+	static_assert(UPLOADER_RING_BYTES >= UPLOAD_WINDOW * UPLOAD_MAX_FRAME, "ring must hold a window of frames");
+
+	public:
+		/** Prepare upload, without receiving yet
+		  * @param [in] serial Serial port, at UPLOAD_BAUD on the host side
+		  * @param [in] output Log sending on the same serial port
+		  * @param [in] store  Content store to write
+		  */
+		Uploader(RawSerial & serial, Logger & output, ContentStore & store);
+
+		/** Start reception and create upload task
+		  * @param [in] priority Priority of upload task
+		  * @return false if out of memory
+		  */
+		bool start(unsigned priority = tskIDLE_PRIORITY + 1UL);
+
+		/** Give number of stores uploaded
+		  * @return Number of uploads
+		  */
+		uint32_t uploads() const { return uploaded; }
+
+		/** Give number of frames dropped for a bad CRC
+		  * @return Number of frames
+		  */
+		uint32_t errors() const { return receiver.parser.errors; }
+
+		/** Give number of times received bytes were lost
+		  * @return Number of overruns
+		  */
+		uint32_t overruns() const { return input.overruns(); }
+
+	private:
+		/** Take received bytes as they come **/
+		void run();
+
+		static void task(void * uploader);
+		static int erase(void * uploader, uint32_t size);
+		static int program(void * uploader, uint32_t offset, const uint8_t * data, uint32_t length);
+		static int finish(void * uploader, uint32_t size, uint32_t crc);
+		static void send(void * uploader, const uint8_t * frame, size_t length);
+
+		SerialReceiver input; // Received bytes
+		Logger & output; // Sends acknowledgements
+		ContentStore & store; // Store written
+		struct upload_receiver receiver; // Protocol state
+		volatile uint32_t uploaded; // Stores uploaded
+};
+
+#endif // UPLOADER_H
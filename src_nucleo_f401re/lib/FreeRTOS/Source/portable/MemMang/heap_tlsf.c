@@ -0,0 +1,349 @@
+/*
+ * A pvPortMalloc() and vPortFree() that run in bounded time: two level
+ * segregated fit (TLSF).
+ *
+ * Free blocks are kept in lists by size class. The first level splits sizes
+ * by powers of two, the second level splits each power of two in
+ * heapSL_COUNT classes. A bitmap per level gives the non empty lists, so that
+ * finding a free block big enough is two bit scans, whatever the number of
+ * blocks. A block taken is cut to the size asked, and a block freed is merged
+ * with its free neighbours right away: both take a fixed number of steps.
+ *
+ * Requests are rounded up to the next size class, so that any block of the
+ * list found fits: at most 1 / heapSL_COUNT of a block is wasted this way.
+ * When no class above has a block, the first block of the class of the
+ * request is tried too, so that the largest free block can still be taken.
+ *
+ * Free space and its lowest value since start are kept, see
+ * xPortGetFreeHeapSize() and xPortGetMinimumEverFreeHeapSize(), to size
+ * configTOTAL_HEAP_SIZE from a running system.
+ *
+ * As for the other heap_x.c files, the scheduler is suspended while the heap
+ * is changed: do not call from interrupts.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* Number of second level classes per power of two, as a power of two. */
+#define heapSL_SHIFT			( 3 )
+#define heapSL_COUNT			( 1 << heapSL_SHIFT )
+
+/* Block sizes below heapSMALL_SIZE are all in first level 0, in classes of
+portBYTE_ALIGNMENT bytes. */
+#define heapSMALL_SHIFT			( heapSL_SHIFT + 3 )
+#define heapSMALL_SIZE			( ( size_t ) 1 << heapSMALL_SHIFT )
+
+/* First level classes, up to blocks of 2^( heapFL_COUNT + heapSMALL_SHIFT - 1 )
+bytes: 16 MB. */
+#define heapFL_COUNT			( 19 )
+
+/* Header of every block.  The low bit of xSize is set while the block is free.
+A free block also holds its list links, where data goes when it is used. */
+typedef struct BLOCK_HEADER
+{
+	struct BLOCK_HEADER *pxPreviousPhysical;	/*<< Block just before in memory, NULL for the first one. */
+	size_t xSize;								/*<< Bytes of the block, header included. */
+	struct BLOCK_HEADER *pxNextFree;			/*<< Free blocks of the same class. */
+	struct BLOCK_HEADER *pxPreviousFree;
+} BlockHeader_t;
+
+#define heapFREE_BIT			( ( size_t ) 1 )
+#define heapHEADER_SIZE			( ( offsetof( BlockHeader_t, pxNextFree ) + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK ) )
+#define heapMINIMUM_BLOCK_SIZE	( ( sizeof( BlockHeader_t ) + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK ) )
+
+/* Allocate the memory for the heap. */
+static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+
+/* Lists of free blocks, and bitmaps of the non empty ones. */
+static BlockHeader_t *pxFreeLists[ heapFL_COUNT ][ heapSL_COUNT ];
+static uint32_t ulFirstLevelMap = 0;
+static uint32_t ulSecondLevelMaps[ heapFL_COUNT ];
+
+static BlockHeader_t *pxEnd = NULL;
+static size_t xFreeBytesRemaining = ( size_t ) 0;
+static size_t xMinimumEverFreeBytesRemaining = ( size_t ) 0;
+
+/*-----------------------------------------------------------*/
+
+/* Index of the highest bit set, value must not be 0. */
+static unsigned prvHighestBit( size_t xValue )
+{
+	return ( unsigned ) ( 8 * sizeof( unsigned long ) - 1 - __builtin_clzl( ( unsigned long ) xValue ) );
+}
+
+/* Index of the lowest bit set, value must not be 0. */
+static unsigned prvLowestBit( uint32_t ulValue )
+{
+	return ( unsigned ) __builtin_ctzl( ( unsigned long ) ulValue );
+}
+
+static size_t prvBlockSize( const BlockHeader_t *pxBlock )
+{
+	return pxBlock->xSize & ~heapFREE_BIT;
+}
+
+static BlockHeader_t *prvNextPhysical( const BlockHeader_t *pxBlock )
+{
+	return ( BlockHeader_t * ) ( ( ( uint8_t * ) pxBlock ) + prvBlockSize( pxBlock ) );
+}
+
+/* Give the class of a block size. */
+static void prvMapping( size_t xSize, unsigned *puxFirst, unsigned *puxSecond )
+{
+	if( xSize < heapSMALL_SIZE )
+	{
+		*puxFirst = 0;
+		*puxSecond = ( unsigned ) ( xSize / ( heapSMALL_SIZE / heapSL_COUNT ) );
+	}
+	else
+	{
+		unsigned uxHighest = prvHighestBit( xSize );
+		*puxFirst = uxHighest - ( heapSMALL_SHIFT - 1 );
+		*puxSecond = ( unsigned ) ( xSize >> ( uxHighest - heapSL_SHIFT ) ) ^ heapSL_COUNT;
+	}
+}
+
+static void prvInsertFreeBlock( BlockHeader_t *pxBlock )
+{
+unsigned uxFirst, uxSecond;
+
+	prvMapping( prvBlockSize( pxBlock ), &uxFirst, &uxSecond );
+	pxBlock->xSize |= heapFREE_BIT;
+	pxBlock->pxPreviousFree = NULL;
+	pxBlock->pxNextFree = pxFreeLists[ uxFirst ][ uxSecond ];
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPreviousFree = pxBlock;
+	}
+	pxFreeLists[ uxFirst ][ uxSecond ] = pxBlock;
+	ulFirstLevelMap |= 1UL << uxFirst;
+	ulSecondLevelMaps[ uxFirst ] |= 1UL << uxSecond;
+}
+
+static void prvRemoveFreeBlock( BlockHeader_t *pxBlock )
+{
+unsigned uxFirst, uxSecond;
+
+	prvMapping( prvBlockSize( pxBlock ), &uxFirst, &uxSecond );
+	pxBlock->xSize &= ~heapFREE_BIT;
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPreviousFree = pxBlock->pxPreviousFree;
+	}
+	if( pxBlock->pxPreviousFree != NULL )
+	{
+		pxBlock->pxPreviousFree->pxNextFree = pxBlock->pxNextFree;
+	}
+	else
+	{
+		pxFreeLists[ uxFirst ][ uxSecond ] = pxBlock->pxNextFree;
+		if( pxBlock->pxNextFree == NULL )
+		{
+			ulSecondLevelMaps[ uxFirst ] &= ~( 1UL << uxSecond );
+			if( ulSecondLevelMaps[ uxFirst ] == 0 )
+			{
+				ulFirstLevelMap &= ~( 1UL << uxFirst );
+			}
+		}
+	}
+}
+
+/* Find a free block of at least xSize bytes, rounding up to a class whose
+blocks all fit. */
+static BlockHeader_t *prvFindFreeBlock( size_t xSize )
+{
+unsigned uxFirst, uxSecond;
+uint32_t ulMap;
+size_t xRounded = xSize;
+
+	if( xSize >= heapSMALL_SIZE )
+	{
+		xRounded += ( ( size_t ) 1 << ( prvHighestBit( xSize ) - heapSL_SHIFT ) ) - 1;
+		if( xRounded < xSize )
+		{
+			return NULL;
+		}
+	}
+	prvMapping( xRounded, &uxFirst, &uxSecond );
+
+	ulMap = ( uxFirst < heapFL_COUNT ) ? ( ulSecondLevelMaps[ uxFirst ] & ( ~0UL << uxSecond ) ) : 0;
+	if( ulMap == 0 )
+	{
+		/* Nothing in this power of two, take the smallest class above. */
+		ulMap = ( uxFirst + 1 < heapFL_COUNT ) ? ( ulFirstLevelMap & ( ~0UL << ( uxFirst + 1 ) ) ) : 0;
+		if( ulMap == 0 )
+		{
+			/* Only blocks of the class of xSize are left, the first one may
+			still fit: the largest block can be taken this way. */
+			prvMapping( xSize, &uxFirst, &uxSecond );
+			if( ( uxFirst < heapFL_COUNT ) && ( pxFreeLists[ uxFirst ][ uxSecond ] != NULL ) &&
+				( prvBlockSize( pxFreeLists[ uxFirst ][ uxSecond ] ) >= xSize ) )
+			{
+				return pxFreeLists[ uxFirst ][ uxSecond ];
+			}
+			return NULL;
+		}
+		uxFirst = prvLowestBit( ulMap );
+		ulMap = ulSecondLevelMaps[ uxFirst ];
+	}
+	uxSecond = prvLowestBit( ulMap );
+	return pxFreeLists[ uxFirst ][ uxSecond ];
+}
+
+static void prvHeapInit( void )
+{
+uint8_t *pucStart, *pucEnd;
+BlockHeader_t *pxBlock;
+
+	/* Ensure the heap starts and ends on a correctly aligned boundary. */
+	pucStart = ( uint8_t * ) ( ( ( portPOINTER_SIZE_TYPE ) &ucHeap[ portBYTE_ALIGNMENT_MASK ] ) & ( ( portPOINTER_SIZE_TYPE ) ~portBYTE_ALIGNMENT_MASK ) );
+	pucEnd = ( uint8_t * ) ( ( ( portPOINTER_SIZE_TYPE ) &ucHeap[ configTOTAL_HEAP_SIZE ] ) & ( ( portPOINTER_SIZE_TYPE ) ~portBYTE_ALIGNMENT_MASK ) );
+
+	/* One free block, then a used block of no size that stops merging. */
+	pxEnd = ( BlockHeader_t * ) ( pucEnd - heapMINIMUM_BLOCK_SIZE );
+	pxBlock = ( BlockHeader_t * ) pucStart;
+	pxBlock->pxPreviousPhysical = NULL;
+	pxBlock->xSize = ( size_t ) ( ( uint8_t * ) pxEnd - pucStart );
+	pxEnd->pxPreviousPhysical = pxBlock;
+	pxEnd->xSize = 0;
+	prvInsertFreeBlock( pxBlock );
+
+	xFreeBytesRemaining = prvBlockSize( pxBlock );
+	xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+void *pvReturn = NULL;
+BlockHeader_t *pxBlock, *pxRemainder;
+size_t xSize;
+
+	/* Header, then data aligned to the required number of bytes. */
+	xSize = ( xWantedSize + heapHEADER_SIZE + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+	if( xSize < heapMINIMUM_BLOCK_SIZE )
+	{
+		xSize = heapMINIMUM_BLOCK_SIZE;
+	}
+
+	vTaskSuspendAll();
+	{
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+
+		/* Check for overflow, then find a block. */
+		pxBlock = ( xSize > xWantedSize ) ? prvFindFreeBlock( xSize ) : NULL;
+		if( pxBlock != NULL )
+		{
+			prvRemoveFreeBlock( pxBlock );
+
+			/* Give back what is left, if it can make a block. */
+			if( prvBlockSize( pxBlock ) - xSize >= heapMINIMUM_BLOCK_SIZE )
+			{
+				pxRemainder = ( BlockHeader_t * ) ( ( ( uint8_t * ) pxBlock ) + xSize );
+				pxRemainder->pxPreviousPhysical = pxBlock;
+				pxRemainder->xSize = prvBlockSize( pxBlock ) - xSize;
+				prvNextPhysical( pxRemainder )->pxPreviousPhysical = pxRemainder;
+				pxBlock->xSize = xSize;
+				prvInsertFreeBlock( pxRemainder );
+			}
+
+			xFreeBytesRemaining -= prvBlockSize( pxBlock );
+			if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+			{
+				xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+			}
+			pvReturn = ( ( uint8_t * ) pxBlock ) + heapHEADER_SIZE;
+		}
+
+		traceMALLOC( pvReturn, xWantedSize );
+	}
+	( void ) xTaskResumeAll();
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+BlockHeader_t *pxBlock, *pxNeighbour;
+
+	if( pv == NULL )
+	{
+		return;
+	}
+
+	pxBlock = ( BlockHeader_t * ) ( ( ( uint8_t * ) pv ) - heapHEADER_SIZE );
+
+	/* Freeing a block twice would corrupt the lists. */
+	configASSERT( ( pxBlock->xSize & heapFREE_BIT ) == 0 );
+
+	vTaskSuspendAll();
+	{
+		xFreeBytesRemaining += prvBlockSize( pxBlock );
+		traceFREE( pv, prvBlockSize( pxBlock ) );
+
+		/* Merge with the free blocks around, so that free blocks are never
+		next to each other. */
+		pxNeighbour = pxBlock->pxPreviousPhysical;
+		if( ( pxNeighbour != NULL ) && ( pxNeighbour->xSize & heapFREE_BIT ) )
+		{
+			prvRemoveFreeBlock( pxNeighbour );
+			pxNeighbour->xSize += prvBlockSize( pxBlock );
+			pxBlock = pxNeighbour;
+		}
+		pxNeighbour = prvNextPhysical( pxBlock );
+		if( pxNeighbour->xSize & heapFREE_BIT )
+		{
+			prvRemoveFreeBlock( pxNeighbour );
+			pxBlock->xSize += prvBlockSize( pxNeighbour );
+		}
+		prvNextPhysical( pxBlock )->pxPreviousPhysical = pxBlock;
+		prvInsertFreeBlock( pxBlock );
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* Only required when static memory is not cleared. */
+	memset( pxFreeLists, 0, sizeof( pxFreeLists ) );
+	memset( ulSecondLevelMaps, 0, sizeof( ulSecondLevelMaps ) );
+	ulFirstLevelMap = 0;
+	pxEnd = NULL;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
@@ -21,6 +21,7 @@
 #if DEVICE_SPI
 
 #include "spi_api.h"
+#include "FunctionPointer.h"
 
 namespace mbed {
 
@@ -92,6 +93,54 @@ public:
     */
     virtual int write(int value);
 
+#if DEVICE_SPI_DMA
+    /** Write a block to the SPI Slave in the background, using DMA
+     *
+     *  Responses of the slave are dropped, and nothing else must be written
+     *  to the SPI until the transfer is done.
+     *
+     *  @param data Data to be sent, 2 bytes per frame with 16 bits format; must stay valid until done
+     *  @param length Number of bytes to send
+     *  @param callback Function called from the DMA interrupt once all data is given to the SPI, or NULL
+     *
+     *  @returns
+     *    0 if the transfer started, -1 if one is in progress or length is not supported
+     */
+    int write(const uint8_t *data, size_t length, void (*callback)(void) = 0);
+
+    /** Write a block to the SPI Slave in the background, using DMA
+     *
+     *  @param data Data to be sent, 2 bytes per frame with 16 bits format; must stay valid until done
+     *  @param length Number of bytes to send
+     *  @param object Object to call once all data is given to the SPI
+     *  @param member Member function to call, from the DMA interrupt
+     *
+     *  @returns
+     *    0 if the transfer started, -1 if one is in progress or length is not supported
+     */
+    template<typename T>
+    int write(const uint8_t *data, size_t length, T *object, void (T::*member)(void)) {
+        if (spi_dma_busy(&_spi)) {
+            return -1;
+        }
+        _dma_done.attach(object, member);
+        return start_dma(data, length);
+    }
+
+    /** Check if a DMA write is in progress
+     *
+     *  @returns
+     *    1 until the callback of last write is called, 0 otherwise
+     */
+    int write_busy(void);
+
+    /** Set priority of the DMA interrupt, which calls write callbacks
+     *
+     *  @param priority NVIC priority, 0 being the highest
+     */
+    void dma_priority(int priority);
+#endif
+
 public:
     virtual ~SPI() {
     }
@@ -100,6 +149,11 @@ protected:
     spi_t _spi;
 
     void aquire(void);
+#if DEVICE_SPI_DMA
+    int start_dma(const uint8_t *data, size_t length);
+    static void _dma_handler(uint32_t id);
+    FunctionPointer _dma_done;
+#endif
     static SPI *_owner;
     int _bits;
     int _mode;
@@ -107,6 +107,95 @@ public:
      */
     void send_break();
 
+#if DEVICE_SERIAL_DMA
+    /** Receive continuously in the background into a circular buffer, using DMA
+     *
+     *  Bytes are written in turn all around the buffer, forever, with no
+     *  interrupt per byte: the caller keeps up with read_position() and takes
+     *  bytes before they are written again.
+     *
+     *  @param buffer Circular buffer, must stay valid until read_stop()
+     *  @param length Number of bytes of buffer, up to 65535
+     *  @param callback Function called from interrupts when the line goes idle after bytes, and each time half of the buffer is written, or NULL
+     *
+     *  @returns
+     *    0 if reception started, -1 if length is not supported
+     */
+    int read_start(uint8_t *buffer, size_t length, void (*callback)(void) = 0);
+
+    /** Receive continuously in the background into a circular buffer, using DMA
+     *
+     *  @param buffer Circular buffer, must stay valid until read_stop()
+     *  @param length Number of bytes of buffer, up to 65535
+     *  @param object Object to call when the line goes idle, and each time half of the buffer is written
+     *  @param member Member function to call, from interrupts
+     *
+     *  @returns
+     *    0 if reception started, -1 if length is not supported
+     */
+    template<typename T>
+    int read_start(uint8_t *buffer, size_t length, T *object, void (T::*member)(void)) {
+        _dma_rx.attach(object, member);
+        return start_dma(buffer, length);
+    }
+
+    /** Stop reception into the circular buffer
+     */
+    void read_stop(void);
+
+    /** Give where the next received byte goes
+     *
+     *  @returns
+     *    Index in the circular buffer of the next byte to be written
+     */
+    int read_position(void);
+
+    /** Write a block in the background, using DMA
+     *
+     *  Nothing else must be written to the serial port until the transfer is done.
+     *
+     *  @param data Data to be sent, must stay valid until done
+     *  @param length Number of bytes to send, up to 65535
+     *  @param callback Function called from the DMA interrupt once all data is given to the serial port, or NULL
+     *
+     *  @returns
+     *    0 if the transfer started, -1 if one is in progress or length is not supported
+     */
+    int write(const uint8_t *data, size_t length, void (*callback)(void) = 0);
+
+    /** Write a block in the background, using DMA
+     *
+     *  @param data Data to be sent, must stay valid until done
+     *  @param length Number of bytes to send, up to 65535
+     *  @param object Object to call once all data is given to the serial port
+     *  @param member Member function to call, from the DMA interrupt
+     *
+     *  @returns
+     *    0 if the transfer started, -1 if one is in progress or length is not supported
+     */
+    template<typename T>
+    int write(const uint8_t *data, size_t length, T *object, void (T::*member)(void)) {
+        if (serial_tx_dma_busy(&_serial)) {
+            return -1;
+        }
+        _dma_tx.attach(object, member);
+        return start_write_dma(data, length);
+    }
+
+    /** Check if a DMA write is in progress
+     *
+     *  @returns
+     *    1 until the callback of last write is called, 0 otherwise
+     */
+    int write_busy(void);
+
+    /** Set priority of the interrupts calling back reception and transmission
+     *
+     *  @param priority NVIC priority, 0 (highest) to 15
+     */
+    void dma_priority(int priority);
+#endif
+
 #if DEVICE_SERIAL_FC
     /** Set the flow control type on the serial port
      *
@@ -127,6 +216,14 @@ protected:
     int _base_getc();
     int _base_putc(int c);
 
+#if DEVICE_SERIAL_DMA
+    int start_dma(uint8_t *buffer, size_t length);
+    int start_write_dma(const uint8_t *data, size_t length);
+    static void _dma_handler(uint32_t id);
+    static void _dma_tx_handler(uint32_t id);
+    FunctionPointer _dma_rx;
+    FunctionPointer _dma_tx;
+#endif
     serial_t        _serial;
     FunctionPointer _irq[2];
     int             _baud;
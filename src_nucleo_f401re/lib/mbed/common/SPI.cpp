@@ -27,6 +27,9 @@ SPI::SPI(PinName mosi, PinName miso, PinName sclk, PinName _unused) :
     spi_init(&_spi, mosi, miso, sclk, NC);
     spi_format(&_spi, _bits, _mode, 0);
     spi_frequency(&_spi, _hz);
+#if DEVICE_SPI_DMA
+    spi_dma_irq_handler(&_spi, SPI::_dma_handler, (uint32_t)this);
+#endif
 }
 
 void SPI::format(int bits, int mode) {
@@ -58,6 +61,37 @@ int SPI::write(int value) {
     return spi_master_write(&_spi, value);
 }
 
+#if DEVICE_SPI_DMA
+int SPI::write(const uint8_t *data, size_t length, void (*callback)(void)) {
+    if (spi_dma_busy(&_spi)) {
+        return -1;
+    }
+    _dma_done.attach(callback);
+    return start_dma(data, length);
+}
+
+int SPI::write_busy(void) {
+    return spi_dma_busy(&_spi);
+}
+
+void SPI::dma_priority(int priority) {
+    spi_dma_irq_priority(&_spi, priority);
+}
+
+int SPI::start_dma(const uint8_t *data, size_t length) {
+    if (length > 0x7FFFFFFF) {
+        return -1;
+    }
+    aquire();
+    return spi_master_write_dma(&_spi, data, (int)length);
+}
+
+void SPI::_dma_handler(uint32_t id) {
+    SPI *handler = (SPI*)id;
+    handler->_dma_done.call();
+}
+#endif
+
 } // namespace mbed
 
 #endif
@@ -23,6 +23,10 @@ namespace mbed {
 SerialBase::SerialBase(PinName tx, PinName rx) : _serial(), _baud(9600) {
     serial_init(&_serial, tx, rx);
     serial_irq_handler(&_serial, SerialBase::_irq_handler, (uint32_t)this);
+#if DEVICE_SERIAL_DMA
+    serial_rx_dma_irq_handler(&_serial, SerialBase::_dma_handler, (uint32_t)this);
+    serial_tx_dma_irq_handler(&_serial, SerialBase::_dma_tx_handler, (uint32_t)this);
+#endif
 }
 
 void SerialBase::baud(int baudrate) {
@@ -80,6 +84,61 @@ void SerialBase::send_break() {
   serial_break_clear(&_serial);
 }
 
+#if DEVICE_SERIAL_DMA
+int SerialBase::read_start(uint8_t *buffer, size_t length, void (*callback)(void)) {
+    _dma_rx.attach(callback);
+    return start_dma(buffer, length);
+}
+
+void SerialBase::read_stop(void) {
+    serial_rx_dma_stop(&_serial);
+}
+
+int SerialBase::read_position(void) {
+    return serial_rx_dma_position(&_serial);
+}
+
+int SerialBase::write(const uint8_t *data, size_t length, void (*callback)(void)) {
+    if (serial_tx_dma_busy(&_serial)) {
+        return -1;
+    }
+    _dma_tx.attach(callback);
+    return start_write_dma(data, length);
+}
+
+int SerialBase::write_busy(void) {
+    return serial_tx_dma_busy(&_serial);
+}
+
+void SerialBase::dma_priority(int priority) {
+    serial_dma_irq_priority(&_serial, priority);
+}
+
+int SerialBase::start_dma(uint8_t *buffer, size_t length) {
+    if (length > 0xFFFF) {
+        return -1;
+    }
+    return serial_rx_dma_start(&_serial, buffer, (int)length);
+}
+
+int SerialBase::start_write_dma(const uint8_t *data, size_t length) {
+    if (length > 0xFFFF) {
+        return -1;
+    }
+    return serial_tx_dma_start(&_serial, data, (int)length);
+}
+
+void SerialBase::_dma_handler(uint32_t id) {
+    SerialBase *handler = (SerialBase*)id;
+    handler->_dma_rx.call();
+}
+
+void SerialBase::_dma_tx_handler(uint32_t id) {
+    SerialBase *handler = (SerialBase*)id;
+    handler->_dma_tx.call();
+}
+#endif
+
 #if DEVICE_SERIAL_FC
 void SerialBase::set_flow_control(Flow type, PinName flow1, PinName flow2) {
     FlowControl flow_type = (FlowControl)type;
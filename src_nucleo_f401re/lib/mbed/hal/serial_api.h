@@ -69,6 +69,19 @@ void serial_pinout_tx(PinName tx);
 
 void serial_set_flow_control(serial_t *obj, FlowControl type, PinName rxflow, PinName txflow);
 
+#if DEVICE_SERIAL_DMA
+typedef void (*serial_dma_handler)(uint32_t id);
+
+void serial_rx_dma_irq_handler(serial_t *obj, serial_dma_handler handler, uint32_t id);
+void serial_dma_irq_priority  (serial_t *obj, uint32_t priority);
+int  serial_rx_dma_start      (serial_t *obj, void *buffer, int length);
+void serial_rx_dma_stop       (serial_t *obj);
+int  serial_rx_dma_position   (serial_t *obj);
+void serial_tx_dma_irq_handler(serial_t *obj, serial_dma_handler handler, uint32_t id);
+int  serial_tx_dma_start      (serial_t *obj, const void *data, int length);
+int  serial_tx_dma_busy       (serial_t *obj);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -36,6 +36,15 @@ int  spi_slave_read   (spi_t *obj);
 void spi_slave_write  (spi_t *obj, int value);
 int  spi_busy         (spi_t *obj);
 
+#if DEVICE_SPI_DMA
+typedef void (*spi_dma_handler)(uint32_t id);
+
+void spi_dma_irq_handler (spi_t *obj, spi_dma_handler handler, uint32_t id);
+void spi_dma_irq_priority(spi_t *obj, uint32_t priority);
+int  spi_master_write_dma(spi_t *obj, const void *data, int length);
+int  spi_dma_busy        (spi_t *obj);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
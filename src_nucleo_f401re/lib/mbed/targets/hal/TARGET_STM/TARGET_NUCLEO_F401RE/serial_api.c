@@ -60,6 +60,10 @@ static uint32_t serial_irq_ids[UART_NUM] = {0, 0, 0};
 
 static uart_irq_handler irq_handler;
 
+#if DEVICE_SERIAL_DMA
+static void rx_dma_event(int index);
+#endif
+
 UART_HandleTypeDef UartHandle;
 
 int stdio_uart_inited = 0;
@@ -203,6 +207,14 @@ void serial_format(serial_t *obj, int data_bits, SerialParity parity, int stop_b
 
 static void uart_irq(UARTName name, int id) {
     UartHandle.Instance = (USART_TypeDef *)name;
+#if DEVICE_SERIAL_DMA
+    USART_TypeDef *uart = (USART_TypeDef *)name;
+    if ((uart->CR1 & USART_CR1_IDLEIE) && (uart->SR & USART_SR_IDLE)) {
+        // Cleared by reading SR then DR, the last byte was taken by DMA already
+        (void)uart->DR;
+        rx_dma_event(id);
+    }
+#endif
     if (serial_irq_ids[id] != 0) {
         if (__HAL_UART_GET_FLAG(&UartHandle, UART_FLAG_TC) != RESET) {
             irq_handler(serial_irq_ids[id], TxIrq);
@@ -276,6 +288,11 @@ void serial_irq_set(serial_t *obj, SerialIrq irq, uint32_t enable) {
             if ((UartHandle.Instance->CR1 & USART_CR1_RXNEIE) == 0) all_disabled = 1;
         }
 
+#if DEVICE_SERIAL_DMA
+        // Idle line still signals DMA reception
+        if (UartHandle.Instance->CR1 & USART_CR1_IDLEIE) all_disabled = 0;
+#endif
+
         if (all_disabled) NVIC_DisableIRQ(irq_n);
 
     }
@@ -331,4 +348,215 @@ void serial_break_set(serial_t *obj) {
 void serial_break_clear(serial_t *obj) {
 }
 
+#if DEVICE_SERIAL_DMA
+
+/******************************************************************************
+ * DMA RECEPTION AND TRANSMISSION
+ ******************************************************************************/
+
+// DMA stream of UART reception or transmission, with its flags in the DMA interrupt status registers
+typedef struct {
+    DMA_TypeDef *dma;
+    DMA_Stream_TypeDef *stream;
+    uint32_t channel;
+    IRQn_Type irq;
+    volatile uint32_t *isr;
+    volatile uint32_t *ifcr;
+    uint32_t shift;
+    IRQn_Type uart_irq;
+    void (*uart_vector)(void);
+} serial_dma_t;
+
+// Indexed like serial_irq_ids
+static const serial_dma_t serial_rx_dma[UART_NUM] = {
+    {DMA2, DMA2_Stream5, 4, DMA2_Stream5_IRQn, &DMA2->HISR, &DMA2->HIFCR, 6,  USART1_IRQn, uart1_irq},
+    {DMA1, DMA1_Stream5, 4, DMA1_Stream5_IRQn, &DMA1->HISR, &DMA1->HIFCR, 6,  USART2_IRQn, uart2_irq},
+    {DMA2, DMA2_Stream1, 5, DMA2_Stream1_IRQn, &DMA2->LISR, &DMA2->LIFCR, 6,  USART6_IRQn, uart6_irq}
+};
+
+static const serial_dma_t serial_tx_dma[UART_NUM] = {
+    {DMA2, DMA2_Stream7, 4, DMA2_Stream7_IRQn, &DMA2->HISR, &DMA2->HIFCR, 22, USART1_IRQn, uart1_irq},
+    {DMA1, DMA1_Stream6, 4, DMA1_Stream6_IRQn, &DMA1->HISR, &DMA1->HIFCR, 16, USART2_IRQn, uart2_irq},
+    {DMA2, DMA2_Stream6, 5, DMA2_Stream6_IRQn, &DMA2->HISR, &DMA2->HIFCR, 16, USART6_IRQn, uart6_irq}
+};
+
+// Flags of a stream, before shift: FEIF, DMEIF, TEIF, HTIF and TCIF
+#define SERIAL_DMA_FLAGS 0x3D
+#define SERIAL_DMA_TEIF  0x08
+#define SERIAL_DMA_TCIF  0x20
+
+static const UARTName serial_uarts[UART_NUM] = {UART_1, UART_2, UART_6};
+
+static serial_dma_handler rx_dma_handlers[UART_NUM];
+static uint32_t rx_dma_ids[UART_NUM];
+static int rx_dma_lengths[UART_NUM];
+
+static void rx_dma_event(int index) {
+    if (rx_dma_handlers[index] != 0) {
+        rx_dma_handlers[index](rx_dma_ids[index]);
+    }
+}
+
+// Half and whole buffer written, or transfer error which stops the stream
+static void rx_dma_irq(int index) {
+    const serial_dma_t *dma = &serial_rx_dma[index];
+    uint32_t flags = (*dma->isr >> dma->shift) & SERIAL_DMA_FLAGS;
+    *dma->ifcr = flags << dma->shift;
+    rx_dma_event(index);
+}
+
+static void rx_dma_irq_uart1(void) {rx_dma_irq(0);}
+static void rx_dma_irq_uart2(void) {rx_dma_irq(1);}
+static void rx_dma_irq_uart6(void) {rx_dma_irq(2);}
+
+static void (*const rx_dma_vectors[UART_NUM])(void) = {
+    rx_dma_irq_uart1,
+    rx_dma_irq_uart2,
+    rx_dma_irq_uart6
+};
+
+void serial_rx_dma_irq_handler(serial_t *obj, serial_dma_handler handler, uint32_t id) {
+    rx_dma_handlers[obj->index] = handler;
+    rx_dma_ids[obj->index] = id;
+}
+
+void serial_dma_irq_priority(serial_t *obj, uint32_t priority) {
+    const serial_dma_t *dma = &serial_rx_dma[obj->index];
+    NVIC_SetPriority(dma->irq, priority);
+    NVIC_SetPriority(dma->uart_irq, priority);
+    NVIC_SetPriority(serial_tx_dma[obj->index].irq, priority);
+}
+
+int serial_rx_dma_start(serial_t *obj, void *buffer, int length) {
+    if ((obj->pin_rx == NC) || (length <= 0) || (length > 0xFFFF)) {
+        return -1;
+    }
+
+    const serial_dma_t *dma = &serial_rx_dma[obj->index];
+    USART_TypeDef *uart = (USART_TypeDef *)(obj->uart);
+    DMA_Stream_TypeDef *stream = dma->stream;
+
+    if (dma->dma == DMA2) {
+        __DMA2_CLK_ENABLE();
+    } else {
+        __DMA1_CLK_ENABLE();
+    }
+    stream->CR &= ~DMA_SxCR_EN;
+    while (stream->CR & DMA_SxCR_EN);
+    *dma->ifcr = SERIAL_DMA_FLAGS << dma->shift;
+
+    // Circular transfer from the data register, until stopped
+    stream->PAR = (uint32_t)&uart->DR;
+    stream->M0AR = (uint32_t)buffer;
+    stream->NDTR = length;
+    rx_dma_lengths[obj->index] = length;
+    stream->FCR = 0; // Direct mode
+    stream->CR = (dma->channel << 25) | DMA_SxCR_MINC | DMA_SxCR_CIRC |
+                 DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    stream->CR |= DMA_SxCR_EN;
+    NVIC_SetVector(dma->irq, (uint32_t)rx_dma_vectors[obj->index]);
+    NVIC_EnableIRQ(dma->irq);
+
+    // Idle line ends each burst of bytes
+    (void)uart->SR;
+    (void)uart->DR;
+    uart->CR3 |= USART_CR3_DMAR;
+    uart->CR1 |= USART_CR1_IDLEIE;
+    NVIC_SetVector(dma->uart_irq, (uint32_t)dma->uart_vector);
+    NVIC_EnableIRQ(dma->uart_irq);
+    return 0;
+}
+
+void serial_rx_dma_stop(serial_t *obj) {
+    const serial_dma_t *dma = &serial_rx_dma[obj->index];
+    USART_TypeDef *uart = (USART_TypeDef *)(obj->uart);
+
+    uart->CR1 &= ~USART_CR1_IDLEIE;
+    uart->CR3 &= ~USART_CR3_DMAR;
+    dma->stream->CR &= ~DMA_SxCR_EN;
+    while (dma->stream->CR & DMA_SxCR_EN);
+    NVIC_DisableIRQ(dma->irq);
+}
+
+int serial_rx_dma_position(serial_t *obj) {
+    // Stream counts down bytes left before wrapping, reloaded at 0
+    uint32_t left = serial_rx_dma[obj->index].stream->NDTR;
+    return (left == 0) ? 0 : rx_dma_lengths[obj->index] - (int)left;
+}
+
+static serial_dma_handler tx_dma_handlers[UART_NUM];
+static uint32_t tx_dma_ids[UART_NUM];
+static volatile int tx_dma_busy[UART_NUM];
+
+static void tx_dma_irq(int index) {
+    const serial_dma_t *dma = &serial_tx_dma[index];
+    uint32_t flags = (*dma->isr >> dma->shift) & SERIAL_DMA_FLAGS;
+    *dma->ifcr = flags << dma->shift;
+
+    if (flags & (SERIAL_DMA_TCIF | SERIAL_DMA_TEIF)) {
+        // All data was given to the UART, the last bytes may still be shifting out
+        ((USART_TypeDef *)serial_uarts[index])->CR3 &= ~USART_CR3_DMAT;
+        tx_dma_busy[index] = 0;
+        if (tx_dma_handlers[index] != 0) {
+            tx_dma_handlers[index](tx_dma_ids[index]);
+        }
+    }
+}
+
+static void tx_dma_irq_uart1(void) {tx_dma_irq(0);}
+static void tx_dma_irq_uart2(void) {tx_dma_irq(1);}
+static void tx_dma_irq_uart6(void) {tx_dma_irq(2);}
+
+static void (*const tx_dma_vectors[UART_NUM])(void) = {
+    tx_dma_irq_uart1,
+    tx_dma_irq_uart2,
+    tx_dma_irq_uart6
+};
+
+void serial_tx_dma_irq_handler(serial_t *obj, serial_dma_handler handler, uint32_t id) {
+    const serial_dma_t *dma = &serial_tx_dma[obj->index];
+
+    tx_dma_handlers[obj->index] = handler;
+    tx_dma_ids[obj->index] = id;
+
+    if (dma->dma == DMA2) {
+        __DMA2_CLK_ENABLE();
+    } else {
+        __DMA1_CLK_ENABLE();
+    }
+    NVIC_SetVector(dma->irq, (uint32_t)tx_dma_vectors[obj->index]);
+    NVIC_EnableIRQ(dma->irq);
+}
+
+int serial_tx_dma_start(serial_t *obj, const void *data, int length) {
+    if ((obj->pin_tx == NC) || tx_dma_busy[obj->index] || (length <= 0) || (length > 0xFFFF)) {
+        return -1;
+    }
+
+    const serial_dma_t *dma = &serial_tx_dma[obj->index];
+    USART_TypeDef *uart = (USART_TypeDef *)(obj->uart);
+    DMA_Stream_TypeDef *stream = dma->stream;
+
+    stream->CR &= ~DMA_SxCR_EN;
+    while (stream->CR & DMA_SxCR_EN);
+    *dma->ifcr = SERIAL_DMA_FLAGS << dma->shift;
+
+    tx_dma_busy[obj->index] = 1;
+    stream->PAR = (uint32_t)&uart->DR;
+    stream->M0AR = (uint32_t)data;
+    stream->NDTR = length;
+    stream->FCR = 0; // Direct mode
+    stream->CR = (dma->channel << 25) | DMA_SxCR_MINC | DMA_SxCR_DIR_0 |
+                 DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    stream->CR |= DMA_SxCR_EN;
+    uart->CR3 |= USART_CR3_DMAT;
+    return 0;
+}
+
+int serial_tx_dma_busy(serial_t *obj) {
+    return tx_dma_busy[obj->index];
+}
+
+#endif
+
 #endif
@@ -275,6 +275,13 @@ static inline int ssp_busy(spi_t *obj) {
 }
 
 int spi_master_write(spi_t *obj, int value) {
+    SPI_TypeDef *spi = (SPI_TypeDef *)(obj->spi);
+    // Drop what was received during a DMA write, so that the answer is ours
+    if (spi->SR & (SPI_SR_RXNE | SPI_SR_OVR)) {
+        while (ssp_busy(obj));
+        (void)spi->DR;
+        (void)spi->SR;
+    }
     ssp_write(obj, value);
     return ssp_read(obj);
 }
@@ -299,4 +306,138 @@ int spi_busy(spi_t *obj) {
     return ssp_busy(obj);
 }
 
+#if DEVICE_SPI_DMA
+
+// DMA stream of SPI transmission, with its flags in the DMA interrupt status registers
+typedef struct {
+    SPIName spi;
+    DMA_Stream_TypeDef *stream;
+    uint32_t channel;
+    IRQn_Type irq;
+    volatile uint32_t *isr;
+    volatile uint32_t *ifcr;
+    uint32_t shift;
+} spi_dma_t;
+
+// SPI3 could also use DMA1 stream 5, which is the only one of USART2 reception
+static const spi_dma_t spi_dma[] = {
+    {SPI_1, DMA2_Stream3, 3, DMA2_Stream3_IRQn, &DMA2->LISR, &DMA2->LIFCR, 22},
+    {SPI_2, DMA1_Stream4, 0, DMA1_Stream4_IRQn, &DMA1->HISR, &DMA1->HIFCR, 0},
+    {SPI_3, DMA1_Stream7, 0, DMA1_Stream7_IRQn, &DMA1->HISR, &DMA1->HIFCR, 22}
+};
+
+#define SPI_DMA_NUM (sizeof(spi_dma) / sizeof(spi_dma[0]))
+
+// Flags of a stream, before shift: FEIF, DMEIF, TEIF, HTIF and TCIF
+#define SPI_DMA_FLAGS 0x3D
+#define SPI_DMA_TEIF  0x08
+#define SPI_DMA_TCIF  0x20
+
+static spi_dma_handler dma_handlers[SPI_DMA_NUM];
+static uint32_t dma_ids[SPI_DMA_NUM];
+static volatile int dma_busy[SPI_DMA_NUM];
+
+static int dma_index(spi_t *obj) {
+    int i;
+    for (i = 0; i < (int)SPI_DMA_NUM; i++) {
+        if (spi_dma[i].spi == obj->spi) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void dma_irq(int index) {
+    const spi_dma_t *dma = &spi_dma[index];
+    uint32_t flags = (*dma->isr >> dma->shift) & SPI_DMA_FLAGS;
+    *dma->ifcr = flags << dma->shift;
+
+    if (flags & (SPI_DMA_TCIF | SPI_DMA_TEIF)) {
+        // All data was given to the SPI, the last frames may still be shifting out
+        ((SPI_TypeDef *)(dma->spi))->CR2 &= ~SPI_CR2_TXDMAEN;
+        dma_busy[index] = 0;
+        if (dma_handlers[index] != 0) {
+            dma_handlers[index](dma_ids[index]);
+        }
+    }
+}
+
+static void dma_irq_spi1(void) {dma_irq(0);}
+static void dma_irq_spi2(void) {dma_irq(1);}
+static void dma_irq_spi3(void) {dma_irq(2);}
+
+static void (*const dma_vectors[SPI_DMA_NUM])(void) = {
+    dma_irq_spi1,
+    dma_irq_spi2,
+    dma_irq_spi3
+};
+
+void spi_dma_irq_handler(spi_t *obj, spi_dma_handler handler, uint32_t id) {
+    int index = dma_index(obj);
+    MBED_ASSERT(index >= 0);
+
+    dma_handlers[index] = handler;
+    dma_ids[index] = id;
+
+    if (spi_dma[index].stream == DMA2_Stream3) {
+        __DMA2_CLK_ENABLE();
+    } else {
+        __DMA1_CLK_ENABLE();
+    }
+    NVIC_SetVector(spi_dma[index].irq, (uint32_t)dma_vectors[index]);
+    NVIC_EnableIRQ(spi_dma[index].irq);
+}
+
+void spi_dma_irq_priority(spi_t *obj, uint32_t priority) {
+    int index = dma_index(obj);
+    MBED_ASSERT(index >= 0);
+
+    NVIC_SetPriority(spi_dma[index].irq, priority);
+}
+
+int spi_master_write_dma(spi_t *obj, const void *data, int length) {
+    int index = dma_index(obj);
+    if ((index < 0) || dma_busy[index]) {
+        return -1;
+    }
+
+    // Length is in bytes, the stream counts frames
+    uint32_t size = 0;
+    if (obj->bits == SPI_DATASIZE_16BIT) {
+        length /= 2;
+        size = DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0;
+    }
+    if ((length <= 0) || (length > 0xFFFF)) {
+        return -1;
+    }
+
+    const spi_dma_t *dma = &spi_dma[index];
+    SPI_TypeDef *spi = (SPI_TypeDef *)(obj->spi);
+    DMA_Stream_TypeDef *stream = dma->stream;
+
+    stream->CR &= ~DMA_SxCR_EN;
+    while (stream->CR & DMA_SxCR_EN);
+    *dma->ifcr = SPI_DMA_FLAGS << dma->shift;
+
+    dma_busy[index] = 1;
+    stream->PAR = (uint32_t)&spi->DR;
+    stream->M0AR = (uint32_t)data;
+    stream->NDTR = length;
+    stream->FCR = 0; // Direct mode
+    stream->CR = (dma->channel << 25) | DMA_SxCR_PL_1 | size | DMA_SxCR_MINC |
+                 DMA_SxCR_DIR_0 | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    stream->CR |= DMA_SxCR_EN;
+
+    // Frames received meanwhile are dropped, spi_master_write() clears the overrun
+    spi->CR2 |= SPI_CR2_TXDMAEN;
+    return 0;
+}
+
+int spi_dma_busy(spi_t *obj) {
+    int index = dma_index(obj);
+    return ((index >= 0) && dma_busy[index]) ? 1 : 0;
+}
+
+#endif
+
 #endif
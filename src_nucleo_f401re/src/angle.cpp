@@ -0,0 +1,106 @@
+#include "angle.h"
+
+/** Weight of prediction error in filtered period, as a right shift (1/2) **/
+#define ANGLE_PERIOD_SHIFT 1
+
+/** Weight of prediction error in period change, as a right shift (1/8) **/
+#define ANGLE_SLOPE_SHIFT 3
+
+/** Largest prediction error to stay locked, as a right shift of period (1/8) **/
+#define ANGLE_LOCK_SHIFT 3
+
+/** Number of consecutive periods in agreement before angle is given **/
+#define ANGLE_LOCK_PERIODS 3
+
+AngleTracker::AngleTracker(PinName pin, uint32_t steps):
+	input(pin), nsteps(steps), current(0), count(0), filtered(0), slope(0), good(0) {
+	for (int i = 0; i < 2; ++i) {
+		states[i].last = 0;
+		states[i].period = 0;
+		states[i].rate = 0;
+		states[i].interval = 0;
+	}
+}
+
+void AngleTracker::start() {
+	states[current].last = us_ticker_read();
+	input.rise(this, &AngleTracker::index);
+}
+
+AngleTracker::State AngleTracker::read() const {
+	// index() only writes the state not in use, and at most once per revolution
+	const volatile State & s = states[current];
+	State copy;
+	copy.last = s.last;
+	copy.period = s.period;
+	copy.rate = s.rate;
+	copy.interval = s.interval;
+	return copy;
+}
+
+void AngleTracker::index() {
+	uint32_t now = us_ticker_read();
+	const volatile State & previous = states[current];
+	uint32_t measured = now - previous.last;
+
+	// Bounces of the sensor come much sooner than expected, and periods shorter
+	// than a microsecond per step are not a spinning rotor
+	if ((previous.period && measured < previous.period / 2) || measured <= nsteps)
+		return;
+
+	// Track period and its change at each revolution (alpha-beta filter), so
+	// that the predicted period does not lag when rotor speeds up or slows down
+	int32_t predicted = (int32_t) filtered + slope;
+	int32_t error = (int32_t) measured - predicted;
+	if (filtered && predicted > 0 && (error < 0 ? -error : error) <= (predicted >> ANGLE_LOCK_SHIFT)) {
+		filtered = predicted + error / (1 << ANGLE_PERIOD_SHIFT);
+		slope += error / (1 << ANGLE_SLOPE_SHIFT);
+		if (good < ANGLE_LOCK_PERIODS)
+			++good;
+	} else {
+		// Too far from prediction: start over from this period
+		filtered = measured;
+		slope = 0;
+		good = 0;
+	}
+	int32_t estimate = (int32_t) filtered + slope;
+
+	volatile State & next = states[current ^ 1];
+	next.last = now;
+	next.period = (good >= ANGLE_LOCK_PERIODS && estimate > (int32_t) nsteps) ? estimate : 0;
+	next.rate = next.period ? (uint32_t) (((uint64_t) nsteps << 32) / next.period) : 0;
+	next.interval = next.period ? (uint32_t) (((uint64_t) next.period << 16) / nsteps) : 0;
+	current ^= 1;
+	++count;
+
+	revolution.call();
+}
+
+uint32_t AngleTracker::step(uint32_t now) const {
+	State s = read();
+	if (!s.period)
+		return 0;
+
+	// Rotor stopped: no pulse for two periods
+	uint32_t elapsed = now - s.last;
+	if (elapsed >= 2 * s.period)
+		return 0;
+
+	// Rotor slowing down: hold last step until the late pulse comes
+	uint32_t step = ((uint64_t) elapsed * s.rate) >> 32;
+	return (step < nsteps) ? step : nsteps - 1;
+}
+
+uint32_t AngleTracker::time_of(uint32_t step) const {
+	State s = read();
+	return s.last + (uint32_t) (((uint64_t) step * s.interval) >> 16);
+}
+
+uint32_t AngleTracker::period() const {
+	return read().period;
+}
+
+uint32_t AngleTracker::rpm() const {
+	uint32_t period = read().period;
+	return period ? 60000000 / period : 0;
+}
@@ -0,0 +1,98 @@
+#include "columns.h"
+#include "FreeRTOS.h"
+
+/** Timer of the column clock, and its interrupt shared with TIM1 break **/
+#define COLUMNS_TIM TIM9
+#define COLUMNS_IRQ TIM1_BRK_TIM9_IRQn
+
+ColumnClock * ColumnClock::instance = NULL;
+
+ColumnClock::ColumnClock(AngleTracker & angle):
+	angle(angle), callback(NULL), clock(0), base(0), fraction(0), restart(false), current(0), accumulator(0) {
+}
+
+void ColumnClock::start() {
+	instance = this;
+
+	__TIM9_CLK_ENABLE();
+	__TIM9_FORCE_RESET();
+	__TIM9_RELEASE_RESET();
+
+	// Timers on APB2 run twice as fast as the bus when it is divided
+	clock = HAL_RCC_GetPCLK2Freq();
+	if ((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_CFGR_PPRE2_DIV1)
+		clock *= 2;
+
+	// Auto-reload is buffered, so that it can be written during a column for
+	// the next one. Update generation also interrupts, starting column 0.
+	COLUMNS_TIM->CR1 = TIM_CR1_ARPE;
+	COLUMNS_TIM->DIER = TIM_DIER_UIE;
+
+	// Above the kernel, but allowed to call FromISR functions
+	NVIC_SetVector(COLUMNS_IRQ, (uint32_t) &ColumnClock::irq);
+	NVIC_SetPriority(COLUMNS_IRQ, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+	NVIC_EnableIRQ(COLUMNS_IRQ);
+
+	angle.attach(this, &ColumnClock::sync);
+}
+
+void ColumnClock::sync() {
+	uint32_t period = angle.period();
+	if (!period) {
+		COLUMNS_TIM->CR1 &= ~TIM_CR1_CEN;
+		return;
+	}
+
+	// Timer ticks per column with 16 fractional bits, then smallest prescaler
+	// keeping the auto-reload within 16 bits
+	uint64_t interval = (((uint64_t) period * clock / 1000000) << 16) / angle.steps();
+	uint32_t prescaler = interval >> 32;
+	if (prescaler > 0xffff)
+		prescaler = 0xffff;
+	uint32_t scaled = interval / (prescaler + 1);
+	if (scaled < (2 << 16))
+		scaled = 2 << 16;
+
+	base = scaled >> 16;
+	fraction = scaled & 0xffff;
+	restart = true;
+
+	// Load prescaler and auto-reload now, restarting the count
+	COLUMNS_TIM->PSC = prescaler;
+	COLUMNS_TIM->ARR = base - 1;
+	COLUMNS_TIM->EGR = TIM_EGR_UG;
+	COLUMNS_TIM->CR1 |= TIM_CR1_CEN;
+}
+
+void ColumnClock::update() {
+	COLUMNS_TIM->SR = ~TIM_SR_UIF;
+
+	// Column state is only written here: an index pulse preempting this
+	// interrupt raises another update, which restarts cleanly
+	uint32_t column;
+	if (restart) {
+		restart = false;
+		column = 0;
+		accumulator = 0;
+	} else {
+		column = current + 1;
+		if (column >= angle.steps()) {
+			COLUMNS_TIM->CR1 &= ~TIM_CR1_CEN;
+			return;
+		}
+	}
+	current = column;
+
+	// Length of next column, one tick longer when fractions add up to one
+	accumulator += fraction;
+	COLUMNS_TIM->ARR = base - 1 + (accumulator >> 16);
+	accumulator &= 0xffff;
+
+	if (callback)
+		callback(column);
+}
+
+void ColumnClock::irq() {
+	if (COLUMNS_TIM->SR & TIM_SR_UIF)
+		instance->update();
+}
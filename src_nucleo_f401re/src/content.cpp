@@ -0,0 +1,121 @@
+#include <string.h>
+#include "mbed.h"
+#include "content.h"
+
+/** Flash region of the store, from linker script **/
+extern "C" const uint8_t __store_start__[];
+extern "C" const uint8_t __store_end__[];
+
+/** Flash sectors of the store region, as laid out by the linker script **/
+#define STORE_SECTOR FLASH_SECTOR_5
+#define STORE_SECTOR_BYTES (128 * 1024)
+
+ContentStore::ContentStore():
+	header(NULL), room(__store_end__ - __store_start__), current(-1), selected(NULL), switched(0) {
+	open();
+}
+
+bool ContentStore::open() {
+	// Erased flash reads 0xff, which is not a store. An upload cut short
+	// leaves a valid directory before erased flash: only its CRC tells.
+	const struct store_header * h = (const struct store_header *) __store_start__;
+	header = store_check(h, room, 1) ? h : NULL;
+	return header != NULL;
+}
+
+void ContentStore::close() {
+	selected = NULL;
+	current = -1;
+	header = NULL;
+	++switched;
+}
+
+bool ContentStore::erase(uint32_t size) {
+	close();
+	if (size > room)
+		return false;
+	FLASH_EraseInitTypeDef init;
+	init.TypeErase = TYPEERASE_SECTORS;
+	init.Banks = 0;
+	init.Sector = STORE_SECTOR;
+	init.NbSectors = (size + STORE_SECTOR_BYTES - 1) / STORE_SECTOR_BYTES;
+	init.VoltageRange = VOLTAGE_RANGE_3;
+	if (!init.NbSectors)
+		return true;
+	uint32_t error;
+	HAL_FLASH_Unlock();
+	HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&init, &error);
+	HAL_FLASH_Lock();
+	return status == HAL_OK;
+}
+
+bool ContentStore::program(uint32_t offset, const uint8_t * data, uint32_t length) {
+	if (offset % 4 || offset > room || length > room - offset)
+		return false;
+	bool ok = true;
+	HAL_FLASH_Unlock();
+	for (uint32_t i = 0; ok && i < length; i += 4) {
+		// Bytes past the end are left erased
+		uint32_t word = 0xffffffff;
+		memcpy(&word, data + i, (length - i < 4) ? length - i : 4);
+		ok = HAL_FLASH_Program(TYPEPROGRAM_WORD, (uint32_t) __store_start__ + offset + i, word) == HAL_OK;
+	}
+	HAL_FLASH_Lock();
+	return ok;
+}
+
+bool ContentStore::written(uint32_t size, uint32_t crc) const {
+	const struct store_header * h = (const struct store_header *) __store_start__;
+	return size >= sizeof(struct store_header) && size <= room &&
+	       h->size == size && store_crc32(0, __store_start__, size) == crc;
+}
+
+bool ContentStore::verify() const {
+	return header && store_check(header, room, 1);
+}
+
+bool ContentStore::select(uint16_t index) {
+	if (index >= count())
+		return false;
+
+	// Only slice tables can be shown for now
+	const struct store_entry * e = entry(index);
+	const struct slices_header * table = (const struct slices_header *) data(index);
+	if (e->type != STORE_SLICES || e->size < sizeof(struct slices_header) ||
+	    memcmp(table->magic, SLICES_MAGIC, 4) || table->version != SLICES_VERSION ||
+	    !table->steps || !table->step_udeg || !table->leds || !table->turns)
+		return false;
+
+	// Steps must lie within the content
+	if (!table->keyframe) {
+		size_t start = (const uint8_t *) slices_data(table) - (const uint8_t *) table;
+		if (start > e->size || (uint64_t) table->steps * slices_step_bytes(table) > e->size - start)
+			return false;
+	} else {
+		// Keyframe index, then each keyframe, decoding starts there
+		const uint32_t * keyframes = slices_keyframes(table);
+		size_t index = (const uint8_t *) keyframes - (const uint8_t *) table;
+		uint32_t n = (table->steps - 1) / table->keyframe + 1;
+		if (index > e->size || n > (e->size - index) / 4)
+			return false;
+		size_t start = index + (size_t) n * 4;
+		for (uint32_t i = 0; i < n; ++i) {
+			if (keyframes[i] >= e->size - start)
+				return false;
+		}
+	}
+
+	current = index;
+	selected = table;
+	++switched;
+	return true;
+}
+
+bool ContentStore::next() {
+	uint16_t n = count();
+	for (uint16_t i = 1; i <= n; ++i) {
+		if (select((current + i) % n))
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,29 @@
+#include <string.h>
+#include "ledbar.h"
+
+/** Brightness of APA102 leds, 0 to 31 **/
+#define LEDBAR_BRIGHTNESS 31
+
+LedBar::LedBar(PinName mosi, PinName sclk, uint16_t pixels, int type, int hz):
+	spi(mosi, NC, sclk), npixels(pixels), type(type) {
+	if (type == LEDBAR_APA102) {
+		// Start frame, then one clock edge per led for data to go through the chain
+		offset = 4;
+		stride = 4;
+		frame_bytes = offset + pixels * stride + (pixels + 15) / 16;
+	} else {
+		offset = 0;
+		stride = 3;
+		frame_bytes = pixels * stride;
+	}
+	spi.format(8, 0);
+	spi.frequency(hz);
+}
+
+void LedBar::clear(uint8_t * frame) const {
+	memset(frame, 0, frame_bytes);
+	if (type == LEDBAR_APA102) {
+		for (uint16_t i = 0; i < npixels; ++i)
+			frame[offset + i * stride] = 0xe0 | LEDBAR_BRIGHTNESS;
+	}
+}
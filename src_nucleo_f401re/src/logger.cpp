@@ -0,0 +1,133 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "logger.h"
+
+/** Add 1 to a counter shared with interrupts **/
+static void increment(volatile uint32_t * counter) {
+	uint32_t value;
+	do {
+		value = __LDREXW(counter);
+	} while (__STREXW(value + 1, counter));
+}
+
+/** Set a flag unless it is set already
+  * @return true if flag was set by this call
+  */
+static bool claim(volatile uint32_t * flag) {
+	do {
+		if (__LDREXW(flag)) {
+			__CLREX();
+			return false;
+		}
+	} while (__STREXW(1, flag));
+	__DMB();
+	return true;
+}
+
+Logger::Logger(RawSerial & serial):
+	serial(serial), slots(NULL), mask(0), reserved(0), sent(0), sending(1), dropped(0) {
+	// Nothing is sent until start()
+}
+
+bool Logger::start(unsigned count, int priority) {
+	if (!count || (count & (count - 1)))
+		return false;
+	slots = (Slot *) pvPortMalloc(count * sizeof(Slot));
+	if (!slots)
+		return false;
+	for (unsigned i = 0; i < count; ++i)
+		slots[i].ready = 0;
+	mask = count - 1;
+	serial.dma_priority(priority);
+	sending = 0;
+	kick();
+	return true;
+}
+
+Logger::Slot * Logger::reserve() {
+	if (!slots) {
+		increment(&dropped);
+		return NULL;
+	}
+	uint32_t index;
+	do {
+		index = __LDREXW(&reserved);
+		if (index - sent > mask) {
+			__CLREX();
+			increment(&dropped);
+			return NULL;
+		}
+	} while (__STREXW(index + 1, &reserved));
+	return &slots[index & mask];
+}
+
+void Logger::commit(Slot * slot, size_t length) {
+	slot->length = length;
+	__DMB();
+	slot->ready = 1;
+	kick();
+}
+
+bool Logger::printf(const char * format, ...) {
+	Slot * slot = reserve();
+	if (!slot)
+		return false;
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf((char *) slot->data, LOGGER_SLOT_BYTES, format, args);
+	va_end(args);
+	if (n < 0)
+		n = 0;
+	else if (n >= LOGGER_SLOT_BYTES)
+		n = LOGGER_SLOT_BYTES - 1;
+	commit(slot, n);
+	return true;
+}
+
+bool Logger::write(const void * data, size_t length) {
+	if (length > LOGGER_SLOT_BYTES) {
+		increment(&dropped);
+		return false;
+	}
+	Slot * slot = reserve();
+	if (!slot)
+		return false;
+	memcpy(slot->data, data, length);
+	commit(slot, length);
+	return true;
+}
+
+void Logger::kick() {
+	for (;;) {
+		// Whoever sets sending sends the next slot, others leave it to them
+		if (!claim(&sending))
+			return;
+		Slot & slot = slots[sent & mask];
+		if (slot.ready && slot.length) {
+			if (serial.write(slot.data, slot.length, this, &Logger::done))
+				sending = 0;
+			return;
+		}
+		if (slot.ready) {
+			// Nothing to send in this one
+			slot.ready = 0;
+			__DMB();
+			sent = sent + 1;
+		}
+		// Slot may have been marked ready after it was checked
+		__DMB();
+		sending = 0;
+		__DMB();
+		if (!slots[sent & mask].ready)
+			return;
+	}
+}
+
+void Logger::done() {
+	slots[sent & mask].ready = 0;
+	__DMB();
+	sent = sent + 1;
+	sending = 0;
+	kick();
+}
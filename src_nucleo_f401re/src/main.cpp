@@ -5,15 +5,38 @@
 #include "task.h"
 #include "timers.h"
 #include "semphr.h"
+/* Application includes */
+#include "angle.h"
+#include "columns.h"
+#include "ledbar.h"
+#include "pipeline.h"
+#include "content.h"
+#include "uploader.h"
+#include "logger.h"
+
+/* Angle steps in a revolution of the rotor */
+#define ANGLE_STEPS 720
+/* Leds of the bar */
+#define LEDBAR_PIXELS 16
 
 void ToggleLED_Timer(void*);
 void DetectButtonPress(void*);
 void ToggleLED_IPC(void*);
+void RenderColumn(uint32_t, uint8_t*);
 
 xQueueHandle pbq;
 
 DigitalIn pb(PC_13);
 DigitalOut myled1(PA_5);
+AngleTracker angle(D2, ANGLE_STEPS); /* Hall sensor on D2 */
+ColumnClock columns(angle); /* One column per angle step */
+LedBar bar(PB_15, PB_13, LEDBAR_PIXELS); /* SPI2, SPI1 clock is on LED1 */
+ColumnPipeline pipeline(bar, columns, RenderColumn);
+ContentStore store; /* Contents in flash */
+struct slices_player player; /* Playback of selected slice table, by RenderColumn */
+RawSerial pc(USBTX, USBRX); /* ST-Link virtual serial port */
+Logger logger(pc); /* Log and telemetry, sent by DMA */
+Uploader uploader(pc, logger, store); /* New stores, acknowledged through the log */
 
 int main(void)
 {
@@ -27,7 +50,7 @@ int main(void)
 	xTaskCreate(
 			ToggleLED_Timer,                 /* Function pointer */
 			"Task1",                          /* Task name - for debugging only*/
-			configMINIMAL_STACK_SIZE,         /* Stack depth in words */
+			configMINIMAL_STACK_SIZE * 3,     /* Stack depth in words, formatting telemetry */
 			(void*) NULL,                     /* Pointer to tasks arguments (parameter) */
 			tskIDLE_PRIORITY + 2UL,           /* Task priority*/
 			NULL                              /* Task handle */
@@ -49,6 +72,32 @@ int main(void)
 			tskIDLE_PRIORITY + 2UL,
 			NULL);
 
+	/* Switch leds off, their state at power up is random */
+	uint8_t *frame = (uint8_t *) pvPortMalloc(bar.bytes());
+	if (frame == 0) {
+		while(1); /* fatal error */
+	}
+	bar.clear(frame);
+	bar.send(frame);
+
+	/* Show first content of the store, if any */
+	store.next();
+
+	/* Render columns ahead of the column clock */
+	if (!pipeline.start()) {
+		while(1); /* fatal error */
+	}
+
+	/* Log, then take new stores from the host, on the same port */
+	pc.baud(UPLOAD_BAUD);
+	if (!logger.start() || !uploader.start()) {
+		while(1); /* fatal error */
+	}
+
+	/* Track rotor angle */
+	angle.start();
+	columns.start();
+
 	/* Start the RTOS Scheduler */
 	vTaskStartScheduler();
 
@@ -58,11 +107,23 @@ int main(void)
 
 /**
  * TASK 1: Toggle LED via RTOS Timer
+ * 			Fast while rotor speed is not known, slow once angle is locked
+ * 			And send telemetry each time the LED lights up
  */
 void ToggleLED_Timer(void *pvParameters){
 
 	while (1) {
 		myled1 = myled1 ^ 1;
+		if (myled1) {
+			/* One line per slot of the logger, even with 10 digit counters */
+			logger.printf("period %lu us late %lu/%lu/%lu\r\n",
+					(unsigned long) angle.period(), (unsigned long) pipeline.underruns(),
+					(unsigned long) pipeline.overruns(), (unsigned long) pipeline.drops());
+			logger.printf("upload errors %lu log drops %lu\r\n",
+					(unsigned long) uploader.errors(), (unsigned long) logger.drops());
+			logger.printf("heap free %lu lowest %lu\r\n",
+					(unsigned long) xPortGetFreeHeapSize(), (unsigned long) xPortGetMinimumEverFreeHeapSize());
+		}
 
 		/*
 		   Delay for a period of time. vTaskDelay() places the task into
@@ -70,7 +131,7 @@ void ToggleLED_Timer(void *pvParameters){
 		   The delay period is spacified in 'ticks'. We can convert
 		   yhis in milisecond with the constant portTICK_RATE_MS.
 		 */
-		vTaskDelay(500 / portTICK_RATE_MS);
+		vTaskDelay((angle.period() ? 500 : 100) / portTICK_RATE_MS);
 	}
 }
 
@@ -100,7 +161,7 @@ void DetectButtonPress(void *pvParameters){
 
 /**
  * TASK 3: Toggle LED via Inter-Process Communication (IPC)
- *
+ * 			And show next content of the store
  */
 void ToggleLED_IPC(void *pvParameters) {
 
@@ -111,6 +172,7 @@ void ToggleLED_IPC(void *pvParameters) {
 		status = xQueueReceive(pbq, &sig, portMAX_DELAY); /* Receive Message */
 		/* portMAX_DELAY blocks task indefinitely if queue is empty */
 		if(status == pdTRUE) {
+			store.next();
 			for (int i = 0; i < 10; ++i) {
 				myled1 = myled1 ^ 1;
 				vTaskDelay(100 / portTICK_RATE_MS); /* Debounce Delay 10 ms */
@@ -118,3 +180,65 @@ void ToggleLED_IPC(void *pvParameters) {
 		}
 	}
 }
+
+/**
+ * Render a column of the led bar, from the pipeline task
+ * 			First bar of the selected slice table, or a color gradient
+ */
+void RenderColumn(uint32_t column, uint8_t *frame) {
+
+	uint8_t rgb[3];
+	const struct slices_header *table = store.slices();
+
+	bar.clear(frame);
+	if (table == 0) {
+		for (uint16_t i = 0; i < bar.pixels(); ++i) {
+			rgb[0] = column * 255 / ANGLE_STEPS;
+			rgb[1] = i * 255 / bar.pixels();
+			rgb[2] = 255 - rgb[0];
+			bar.set(frame, i, rgb);
+		}
+		return;
+	}
+
+	/* Content switched, maybe to a new store at the same place: delta coded
+	   steps are decoded in RAM, one at a time */
+	static size_t decoded = 0;
+	static uint32_t switches = 0;
+	if (player.header != table || switches != store.switches()) {
+		switches = store.switches();
+		size_t length = slices_step_bytes(table);
+		if (table->keyframe && length > decoded) {
+			/* Heap coalesces freed blocks, stores can be switched forever */
+			vPortFree(player.frame);
+			player.frame = (uint8_t *) pvPortMalloc(length);
+			decoded = player.frame ? length : 0;
+			if (player.frame == 0) {
+				store.next();
+				return;
+			}
+		}
+		player.header = table;
+		slices_seek(&player, 0);
+	}
+
+	/* Angle of this column, in the revolution it is rendered for, and the
+	   step of the table showing it */
+	uint32_t revolution = angle.revolutions();
+	if (column < columns.column())
+		++revolution;
+	uint64_t udeg = ((uint64_t) (revolution % table->turns) * ANGLE_STEPS + column) * 360000000ULL / ANGLE_STEPS;
+	uint32_t step = udeg / table->step_udeg;
+	if (step >= table->steps)
+		step = table->steps - 1;
+	if (step == player.step + 1)
+		slices_next(&player);
+	else if (step != player.step)
+		slices_seek(&player, step);
+
+	uint16_t pixels = (table->pixels < bar.pixels()) ? table->pixels : bar.pixels();
+	for (uint16_t i = 0; i < pixels; ++i) {
+		slices_rgb(&player, 0, i, rgb);
+		bar.set(frame, i, rgb);
+	}
+}
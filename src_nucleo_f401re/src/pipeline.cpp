@@ -0,0 +1,109 @@
+#include "pipeline.h"
+
+ColumnPipeline * ColumnPipeline::instance = NULL;
+
+ColumnPipeline::ColumnPipeline(LedBar & bar, ColumnClock & clock, void (*render)(uint32_t column, uint8_t * frame)):
+	bar(bar), clock(clock), render(render), frames(NULL), depth(0), available(NULL),
+	filled(0), started(0), sending(false), missed(0), busy(0), dropped(0) {
+}
+
+bool ColumnPipeline::start(unsigned depth, unsigned priority) {
+	if (depth < 2)
+		depth = 2;
+	frames = (Frame *) pvPortMalloc(depth * sizeof(Frame));
+	if (!frames)
+		return false;
+	for (unsigned i = 0; i < depth; ++i) {
+		frames[i].data = (uint8_t *) pvPortMalloc(bar.bytes());
+		if (!frames[i].data)
+			return false;
+		bar.clear(frames[i].data);
+	}
+	this->depth = depth;
+
+	available = xSemaphoreCreateCounting(depth, depth);
+	if (!available)
+		return false;
+
+	instance = this;
+	bar.priority(configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+	clock.attach(&ColumnPipeline::on_column);
+
+	return xTaskCreate(&ColumnPipeline::task, "Render", configMINIMAL_STACK_SIZE * 2,
+	                   this, priority, NULL) == pdPASS;
+}
+
+void ColumnPipeline::run() {
+	uint32_t columns = clock.columns();
+	for (;;) {
+		xSemaphoreTake(available, portMAX_DELAY);
+
+		// Frames queued before this one are sent one per column, read their
+		// number and the clock between two columns
+		uint32_t queued, column;
+		do {
+			queued = started;
+			column = clock.column();
+		} while (queued != started);
+		queued = filled - queued;
+
+		Frame & frame = frames[filled % depth];
+		frame.column = (column + 1 + queued) % columns;
+		render(frame.column, frame.data);
+		filled = filled + 1;
+	}
+}
+
+void ColumnPipeline::tick(uint32_t column) {
+	if (sending) {
+		++busy;
+		return;
+	}
+
+	// Nothing is being sent, so every frame before started is free already
+	// and late frames can be freed in order
+	portBASE_TYPE woken = pdFALSE;
+	uint32_t columns = clock.columns();
+	bool shown = false;
+	while (started != filled) {
+		Frame & frame = frames[started % depth];
+		uint32_t late = (column + columns - frame.column) % columns;
+		// Frame of a column to come
+		if (late > columns / 2)
+			break;
+		started = started + 1;
+		if (late == 0) {
+			sending = true;
+			shown = bar.send(frame.data, &ColumnPipeline::on_done) == 0;
+			if (!shown) {
+				sending = false;
+				xSemaphoreGiveFromISR(available, &woken);
+			}
+			break;
+		}
+		++dropped;
+		xSemaphoreGiveFromISR(available, &woken);
+	}
+	if (!shown)
+		++missed;
+	portEND_SWITCHING_ISR(woken);
+}
+
+void ColumnPipeline::done() {
+	portBASE_TYPE woken = pdFALSE;
+	sending = false;
+	xSemaphoreGiveFromISR(available, &woken);
+	portEND_SWITCHING_ISR(woken);
+}
+
+void ColumnPipeline::task(void * pipeline) {
+	((ColumnPipeline *) pipeline)->run();
+}
+
+void ColumnPipeline::on_column(uint32_t column) {
+	instance->tick(column);
+}
+
+void ColumnPipeline::on_done() {
+	instance->done();
+}
@@ -0,0 +1,59 @@
+#include "receiver.h"
+
+SerialReceiver::SerialReceiver(RawSerial & serial):
+	serial(serial), ring(NULL), length(0), ready(NULL), position(0), received(0), taken(0), lost(0) {
+}
+
+bool SerialReceiver::start(size_t length, int priority) {
+	if (!length || length > 32768 || (length & (length - 1)))
+		return false;
+	ring = (uint8_t *) pvPortMalloc(length);
+	if (!ring)
+		return false;
+	this->length = length;
+	vSemaphoreCreateBinary(ready);
+	if (!ready)
+		return false;
+	xSemaphoreTake(ready, 0);
+
+	serial.dma_priority(priority);
+	return serial.read_start(ring, length, this, &SerialReceiver::update) == 0;
+}
+
+void SerialReceiver::update() {
+	// Interrupts come at least every half ring, so the DMA never laps between them
+	size_t head = serial.read_position();
+	received = received + (head + length - position) % length;
+	position = head;
+
+	portBASE_TYPE woken = pdFALSE;
+	xSemaphoreGiveFromISR(ready, &woken);
+	portEND_SWITCHING_ISR(woken);
+}
+
+size_t SerialReceiver::receive(const uint8_t ** chunk, portTickType timeout) {
+	for (;;) {
+		// Bytes counted by interrupts, and written since
+		taskENTER_CRITICAL();
+		uint32_t now = received + (serial.read_position() + length - position) % length;
+		taskEXIT_CRITICAL();
+		uint32_t count = now - taken;
+		if (count > length) {
+			// Bytes were written again before being taken
+			taken = now;
+			lost = lost + 1;
+			continue;
+		}
+		if (count) {
+			// Up to the end of the ring, the rest comes at next call
+			size_t offset = taken % length;
+			if (count > length - offset)
+				count = length - offset;
+			*chunk = ring + offset;
+			taken += count;
+			return count;
+		}
+		if (xSemaphoreTake(ready, timeout) != pdTRUE)
+			return 0;
+	}
+}
@@ -0,0 +1,60 @@
+#include <string.h>
+#include "uploader.h"
+
+Uploader::Uploader(RawSerial & serial, Logger & output, ContentStore & store):
+	input(serial), output(output), store(store), uploaded(0) {
+	memset(&receiver, 0, sizeof(receiver));
+	receiver.context = this;
+	receiver.erase = &Uploader::erase;
+	receiver.program = &Uploader::program;
+	receiver.finish = &Uploader::finish;
+	receiver.send = &Uploader::send;
+}
+
+bool Uploader::start(unsigned priority) {
+	if (!input.start(UPLOADER_RING_BYTES))
+		return false;
+	return xTaskCreate(&Uploader::task, "Upload", configMINIMAL_STACK_SIZE * 2,
+	                   this, priority, NULL) == pdPASS;
+}
+
+void Uploader::run() {
+	for (;;) {
+		const uint8_t * chunk;
+		size_t n = input.receive(&chunk);
+		upload_receive(&receiver, chunk, n);
+	}
+}
+
+void Uploader::task(void * uploader) {
+	((Uploader *) uploader)->run();
+}
+
+int Uploader::erase(void * uploader, uint32_t size) {
+	ContentStore & store = ((Uploader *) uploader)->store;
+	if (size > store.capacity()) {
+		store.close();
+		return UPLOAD_TOO_LARGE;
+	}
+	return store.erase(size) ? UPLOAD_OK : UPLOAD_FLASH_ERROR;
+}
+
+int Uploader::program(void * uploader, uint32_t offset, const uint8_t * data, uint32_t length) {
+	return ((Uploader *) uploader)->store.program(offset, data, length) ? UPLOAD_OK : UPLOAD_FLASH_ERROR;
+}
+
+int Uploader::finish(void * uploader, uint32_t size, uint32_t crc) {
+	// Frames were checked one by one: check the whole image as announced,
+	// then as a store, whose CRC leaves out its header
+	Uploader * self = (Uploader *) uploader;
+	if (!self->store.written(size, crc) || !self->store.open())
+		return UPLOAD_BAD_IMAGE;
+	self->store.next();
+	self->uploaded = self->uploaded + 1;
+	return UPLOAD_OK;
+}
+
+void Uploader::send(void * uploader, const uint8_t * frame, size_t length) {
+	// A dropped acknowledgement makes the host send again after its timeout
+	((Uploader *) uploader)->output.write(frame, length);
+}